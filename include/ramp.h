@@ -0,0 +1,437 @@
+#pragma once
+
+// Linear ramp kernels writing gain-scaled envelope segments into a signal vector.
+// Every variant of ramp_linear evaluates p = s / phaseSamples per sample in double and
+// rounds once to t_sample, so all builds produce the output of the scalar loop bit for bit.
+// ramp_linear_step computes the same ramp as a + b * i in double from the reciprocal of the
+// phase length, which the caller keeps per phase, so it does not divide at all; ramp_affine
+// and ramp_linear_single do this in t_sample precision with twice the lanes per vector (and
+// on ARMv7, NEON at all). ramp_fixed steps an integer table position instead, carried
+// between calls in a t_ramp_fixed.
+
+#include "m_pd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if PD_FLOATSIZE == 32 && defined(__AVX__)
+#include <immintrin.h>
+#define RAMP_KERNEL_AVX 1
+#elif PD_FLOATSIZE == 32 && defined(__SSE2__)
+#include <emmintrin.h>
+#define RAMP_KERNEL_SSE2 1
+#elif PD_FLOATSIZE == 32 && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RAMP_KERNEL_NEON_SINGLE 1
+#if defined(__aarch64__)
+#define RAMP_KERNEL_NEON 1
+#endif
+#endif
+
+// === Stores ===
+// Every kernel writes through these. With an input signal in (adsr~ -vca) they write the
+// envelope, rounded to t_sample, times in[i] in the same pass, which gives the product a
+// separate pass over a rendered envelope would; out may be in itself.
+inline void ramp_store(t_sample *out, const t_sample *in, int i, t_sample env)
+{
+    out[i] = in ? env * in[i] : env;
+}
+
+#if defined(RAMP_KERNEL_AVX) || defined(RAMP_KERNEL_SSE2)
+inline void ramp_store(t_sample *out, const t_sample *in, int i, __m128 env)
+{
+    _mm_storeu_ps(out + i, in ? _mm_mul_ps(env, _mm_loadu_ps(in + i)) : env);
+}
+#endif
+
+#if defined(RAMP_KERNEL_AVX)
+inline void ramp_store(t_sample *out, const t_sample *in, int i, __m256 env)
+{
+    _mm256_storeu_ps(out + i, in ? _mm256_mul_ps(env, _mm256_loadu_ps(in + i)) : env);
+}
+#endif
+
+#if defined(RAMP_KERNEL_NEON_SINGLE)
+inline void ramp_store(t_sample *out, const t_sample *in, int i, float32x4_t env)
+{
+    vst1q_f32(out + i, in ? vmulq_f32(env, vld1q_f32(in + i)) : env);
+}
+#endif
+
+// Scalar reference: out[i] = (base + range * q) * gain with q = p, or q = 1 - p when Reverse
+template <bool Reverse>
+inline void ramp_linear_scalar(t_sample *out, const t_sample *in, int n, int s, double phaseSamples, double base, double range, double gain)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        double p = static_cast<double>(s + i) / phaseSamples;
+        double q = Reverse ? 1.0 - p : p;
+        ramp_store(out, in, i, static_cast<t_sample>((base + range * q) * gain));
+    }
+}
+
+// Writes n samples of a linear ramp starting at sample s of a phase with phaseSamples samples
+template <bool Reverse>
+inline void ramp_linear(t_sample *out, const t_sample *in, int n, int s, double phaseSamples, double base, double range, double gain)
+{
+    int i = 0;
+
+#if defined(RAMP_KERNEL_AVX)
+    const __m256d vN = _mm256_set1_pd(phaseSamples), vBase = _mm256_set1_pd(base);
+    const __m256d vRange = _mm256_set1_pd(range), vGain = _mm256_set1_pd(gain);
+    const __m256d one = _mm256_set1_pd(1.0), four = _mm256_set1_pd(4.0);
+    __m256d idx = _mm256_setr_pd(s, s + 1.0, s + 2.0, s + 3.0);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d p = _mm256_div_pd(idx, vN);
+        if (Reverse)
+            p = _mm256_sub_pd(one, p);
+        __m256d env = _mm256_mul_pd(_mm256_add_pd(vBase, _mm256_mul_pd(vRange, p)), vGain);
+        ramp_store(out, in, i, _mm256_cvtpd_ps(env));
+        idx = _mm256_add_pd(idx, four);
+    }
+#elif defined(RAMP_KERNEL_SSE2)
+    const __m128d vN = _mm_set1_pd(phaseSamples), vBase = _mm_set1_pd(base);
+    const __m128d vRange = _mm_set1_pd(range), vGain = _mm_set1_pd(gain);
+    const __m128d one = _mm_set1_pd(1.0), two = _mm_set1_pd(2.0);
+    __m128d idx = _mm_setr_pd(s, s + 1.0);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128d p0 = _mm_div_pd(idx, vN);
+        idx = _mm_add_pd(idx, two);
+        __m128d p1 = _mm_div_pd(idx, vN);
+        idx = _mm_add_pd(idx, two);
+        if (Reverse)
+        {
+            p0 = _mm_sub_pd(one, p0);
+            p1 = _mm_sub_pd(one, p1);
+        }
+        __m128d env0 = _mm_mul_pd(_mm_add_pd(vBase, _mm_mul_pd(vRange, p0)), vGain);
+        __m128d env1 = _mm_mul_pd(_mm_add_pd(vBase, _mm_mul_pd(vRange, p1)), vGain);
+        ramp_store(out, in, i, _mm_movelh_ps(_mm_cvtpd_ps(env0), _mm_cvtpd_ps(env1)));
+    }
+#elif defined(RAMP_KERNEL_NEON)
+    const float64x2_t vN = vdupq_n_f64(phaseSamples), vBase = vdupq_n_f64(base);
+    const float64x2_t vRange = vdupq_n_f64(range), vGain = vdupq_n_f64(gain);
+    const float64x2_t one = vdupq_n_f64(1.0), two = vdupq_n_f64(2.0);
+    const double first[2] = {static_cast<double>(s), s + 1.0};
+    float64x2_t idx = vld1q_f64(first);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        float64x2_t p0 = vdivq_f64(idx, vN);
+        idx = vaddq_f64(idx, two);
+        float64x2_t p1 = vdivq_f64(idx, vN);
+        idx = vaddq_f64(idx, two);
+        if (Reverse)
+        {
+            p0 = vsubq_f64(one, p0);
+            p1 = vsubq_f64(one, p1);
+        }
+        float64x2_t env0 = vmulq_f64(vaddq_f64(vBase, vmulq_f64(vRange, p0)), vGain);
+        float64x2_t env1 = vmulq_f64(vaddq_f64(vBase, vmulq_f64(vRange, p1)), vGain);
+        ramp_store(out, in, i, vcombine_f32(vcvt_f32_f64(env0), vcvt_f32_f64(env1)));
+    }
+#endif
+
+    ramp_linear_scalar<Reverse>(out + i, in ? in + i : nullptr, n - i, s + i, phaseSamples, base, range, gain);
+}
+
+// Gain-scaled value at sample s of the ramp and its increment per sample; reciprocal is
+// 1 / phaseSamples
+template <bool Reverse>
+inline void ramp_linear_coefficients(int s, double reciprocal, double base, double range, double gain, double &start, double &slope)
+{
+    double p = s * reciprocal;
+    start = (base + range * (Reverse ? 1.0 - p : p)) * gain;
+    slope = (Reverse ? -range : range) * gain * reciprocal;
+}
+
+// Writes n samples of out[i] = a + b * i, evaluated in double and rounded once
+inline void ramp_affine_double(t_sample *out, const t_sample *in, int n, double a, double b)
+{
+    int i = 0;
+
+#if defined(RAMP_KERNEL_AVX)
+    const __m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b), four = _mm256_set1_pd(4.0);
+    __m256d idx = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        ramp_store(out, in, i, _mm256_cvtpd_ps(_mm256_add_pd(va, _mm256_mul_pd(vb, idx))));
+        idx = _mm256_add_pd(idx, four);
+    }
+#elif defined(RAMP_KERNEL_SSE2)
+    const __m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b), two = _mm_set1_pd(2.0);
+    __m128d idx = _mm_setr_pd(0.0, 1.0);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128d env0 = _mm_add_pd(va, _mm_mul_pd(vb, idx));
+        idx = _mm_add_pd(idx, two);
+        __m128d env1 = _mm_add_pd(va, _mm_mul_pd(vb, idx));
+        idx = _mm_add_pd(idx, two);
+        ramp_store(out, in, i, _mm_movelh_ps(_mm_cvtpd_ps(env0), _mm_cvtpd_ps(env1)));
+    }
+#elif defined(RAMP_KERNEL_NEON)
+    const float64x2_t va = vdupq_n_f64(a), vb = vdupq_n_f64(b), two = vdupq_n_f64(2.0);
+    const double first[2] = {0.0, 1.0};
+    float64x2_t idx = vld1q_f64(first);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        float64x2_t env0 = vaddq_f64(va, vmulq_f64(vb, idx));
+        idx = vaddq_f64(idx, two);
+        float64x2_t env1 = vaddq_f64(va, vmulq_f64(vb, idx));
+        idx = vaddq_f64(idx, two);
+        ramp_store(out, in, i, vcombine_f32(vcvt_f32_f64(env0), vcvt_f32_f64(env1)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        ramp_store(out, in, i, static_cast<t_sample>(a + b * i));
+}
+
+// Division free variant of ramp_linear for a phase of 1 / reciprocal samples: the ramp restarts
+// from its value at sample s on every call, so the rounding error of the slope never
+// accumulates over more than one call
+template <bool Reverse>
+inline void ramp_linear_step(t_sample *out, const t_sample *in, int n, int s, double reciprocal, double base, double range, double gain)
+{
+    double start, slope;
+    ramp_linear_coefficients<Reverse>(s, reciprocal, base, range, gain, start, slope);
+    ramp_affine_double(out, in, n, start, slope);
+}
+
+// Writes n samples of out[i] = a + b * i in t_sample precision
+inline void ramp_affine(t_sample *out, const t_sample *in, int n, t_sample a, t_sample b)
+{
+    int i = 0;
+
+#if defined(RAMP_KERNEL_AVX)
+    const __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b), eight = _mm256_set1_ps(8.0f);
+    __m256 idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    for (; i + 8 <= n; i += 8)
+    {
+        ramp_store(out, in, i, _mm256_add_ps(va, _mm256_mul_ps(vb, idx)));
+        idx = _mm256_add_ps(idx, eight);
+    }
+#elif defined(RAMP_KERNEL_SSE2)
+    const __m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), four = _mm_set1_ps(4.0f);
+    __m128 idx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        ramp_store(out, in, i, _mm_add_ps(va, _mm_mul_ps(vb, idx)));
+        idx = _mm_add_ps(idx, four);
+    }
+#elif defined(RAMP_KERNEL_NEON_SINGLE)
+    const float32x4_t va = vdupq_n_f32(a), vb = vdupq_n_f32(b), four = vdupq_n_f32(4.0f);
+    const float first[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t idx = vld1q_f32(first);
+
+    for (; i + 4 <= n; i += 4)
+    {
+        ramp_store(out, in, i, vaddq_f32(va, vmulq_f32(vb, idx)));
+        idx = vaddq_f32(idx, four);
+    }
+#endif
+
+    for (; i < n; ++i)
+        ramp_store(out, in, i, a + b * static_cast<t_sample>(i));
+}
+
+// Single precision variant of ramp_linear: start value and slope are computed once in double
+template <bool Reverse>
+inline void ramp_linear_single(t_sample *out, const t_sample *in, int n, int s, double reciprocal, double base, double range, double gain)
+{
+    double start, slope;
+    ramp_linear_coefficients<Reverse>(s, reciprocal, base, range, gain, start, slope);
+    ramp_affine(out, in, n, static_cast<t_sample>(start), static_cast<t_sample>(slope));
+}
+
+// Writes n samples of the one pole recurrence v = v * c + b times gain, starting at value, and
+// returns v at sample n. Four interleaved chains step four samples at a time with c^4 and the
+// matching offset, so no sample waits for the multiply-add of the one before.
+inline double ramp_one_pole(t_sample *out, const t_sample *in, int n, double value, double c, double b, double gain)
+{
+    int i = 0;
+
+    if (n >= 8)
+    {
+        const double c2 = c * c, c4 = c2 * c2, b4 = b * (1.0 + c) * (1.0 + c2);
+        double v0 = value, v1 = v0 * c + b, v2 = v1 * c + b, v3 = v2 * c + b;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            ramp_store(out, in, i, static_cast<t_sample>(v0 * gain));
+            ramp_store(out, in, i + 1, static_cast<t_sample>(v1 * gain));
+            ramp_store(out, in, i + 2, static_cast<t_sample>(v2 * gain));
+            ramp_store(out, in, i + 3, static_cast<t_sample>(v3 * gain));
+            v0 = v0 * c4 + b4;
+            v1 = v1 * c4 + b4;
+            v2 = v2 * c4 + b4;
+            v3 = v3 * c4 + b4;
+        }
+        value = v0;
+    }
+
+    for (; i < n; ++i)
+    {
+        ramp_store(out, in, i, static_cast<t_sample>(value * gain));
+        value = value * c + b;
+    }
+    return value;
+}
+
+// Fine table of ramp_fixed for the first 2^rampFineBits intervals of a curve table, where
+// curves with an exponent below 2 bend too sharply for uniform intervals: rampFineOctaves
+// octaves of 2^rampFineBits steps each. Entry i lies at table position
+// 2^(o - rampFineOctaves) * (1 + j / 2^rampFineBits) * 2^rampFineBits with o = i / 2^rampFineBits,
+// j = i % 2^rampFineBits; the last entry is table position 2^rampFineBits.
+const int rampFineBits = 6;
+const int rampFineOctaves = 22;
+const int rampFineSize = rampFineOctaves << rampFineBits;
+
+// Table position of entry i of the fine table
+inline double ramp_fine_position(int i)
+{
+    const int o = i >> rampFineBits, j = i & ((1 << rampFineBits) - 1);
+    return std::ldexp(1.0 + std::ldexp(j, -rampFineBits), o - rampFineOctaves + rampFineBits);
+}
+
+// Helper: value of a Q30 table between entries k and k + 1 at the 32 bit fraction frac
+inline int64_t ramp_fixed_lerp(const int32_t *table, uint32_t k, int64_t frac)
+{
+    const int64_t a = table[k];
+    return a + (((table[k + 1] - a) * frac) >> 32);
+}
+
+// Helper: Q30 curve value at 32.32 table position u, from the fine table below 2^rampFineBits
+template <int TableBits>
+inline int64_t ramp_fixed_curve(const int32_t *table, const int32_t *fine, uint64_t u)
+{
+    const int fineLow = 32 + rampFineBits - rampFineOctaves;  // bit of the first fine entry
+
+    if (u >> (32 + rampFineBits))
+    {
+        const uint32_t k = std::min(static_cast<uint32_t>(u >> 32), (1u << TableBits) - 1);
+        return ramp_fixed_lerp(table, k, static_cast<int64_t>(u - (static_cast<uint64_t>(k) << 32)));
+    }
+    if (u >> fineLow)
+    {
+        // octave from the leading bit, step and fraction from the bits below it
+        const int z = 63 - __builtin_clzll(u);
+        const uint32_t k = static_cast<uint32_t>(((z - fineLow) << rampFineBits) + ((u >> (z - rampFineBits)) & ((1u << rampFineBits) - 1)));
+        return ramp_fixed_lerp(fine, k, static_cast<int64_t>((u << (32 + rampFineBits - z)) & 0xffffffffu));
+    }
+    return (fine[0] * static_cast<int64_t>(u)) >> fineLow;
+}
+
+// Position of a fixed-point ramp: acc and rem at sample `sample` of a phase with `length`
+// samples, where inc and r are quotient and remainder of 2^(32 + TableBits) / length. The caller
+// keeps one per voice, so the divisions happen only when a stage starts, changes its length or
+// continues at another sample than the last call ended at; integer division is a library call
+// on ARMv7.
+struct t_ramp_fixed
+{
+    uint64_t acc, inc;
+    uint32_t rem, r;
+    int length, sample;
+};
+
+// Moves a fixed-point ramp to sample s of a phase with phaseSamples samples
+template <int TableBits>
+inline void ramp_fixed_seek(t_ramp_fixed &f, int s, int phaseSamples)
+{
+    const uint64_t length = static_cast<uint64_t>(phaseSamples);
+
+    if (phaseSamples != f.length)
+    {
+        const uint64_t full = static_cast<uint64_t>(1) << (32 + TableBits);
+        f.inc = full / length;
+        f.r = static_cast<uint32_t>(full % length);
+        f.length = phaseSamples;
+    }
+
+    if (s == 0)
+        f.acc = f.rem = 0;
+    else
+    {
+        // s * r < phaseSamples^2 fits in 64 bits, so no 128 bit product is needed (ARMv7 has none)
+        const uint64_t sr = static_cast<uint64_t>(s) * f.r;
+        f.acc = static_cast<uint64_t>(s) * f.inc + sr / length;
+        f.rem = static_cast<uint32_t>(sr % length);
+    }
+    f.sample = s;
+}
+
+// Helper: samples of ramp_fixed, with the curve (or linear) and the direction fixed at compile time.
+// The position advances by inc and, whenever the remainder rem collects another length, by one
+// more, so it stays the exact quotient rounded down
+template <int TableBits, bool Table, bool Falling>
+inline int64_t ramp_fixed_run(t_sample *out, const t_sample *in, int n, t_ramp_fixed &f, const int32_t *table, const int32_t *fine, double a, double b)
+{
+    const uint64_t full = static_cast<uint64_t>(1) << (32 + TableBits);
+    const int64_t one = static_cast<int64_t>(1) << 30;
+    const uint64_t inc = f.inc, r = f.r, length = static_cast<uint64_t>(f.length);
+    uint64_t acc = f.acc, rem = f.rem;
+    int64_t y = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (!Table)
+            y = static_cast<int64_t>(acc >> (TableBits + 2));
+        else if (Falling)
+            y = one - ramp_fixed_curve<TableBits>(table, fine, full - acc);
+        else
+            y = ramp_fixed_curve<TableBits>(table, fine, acc);
+
+        const double scaled = b * static_cast<double>(y);
+        ramp_store(out, in, i, static_cast<t_sample>(a + scaled));
+
+        rem += r;
+        const uint64_t carry = rem >= length;
+        acc += inc + carry;
+        rem -= carry * length;
+    }
+
+    f.acc = acc;
+    f.rem = static_cast<uint32_t>(rem);
+    f.sample += n;
+    return y;
+}
+
+// Fixed-point ramp: out[i] = (start + range * y) * gain for samples s .. s + n - 1 of a phase
+// with phaseSamples samples; returns the unscaled level of the last one. The position is a 32.32
+// fixed-point index into a Q30 table of 2^TableBits intervals, at sample s exactly
+// s * 2^(32 + TableBits) / phaseSamples rounded down, so the output does not depend on where
+// blocks begin and the end of a long phase does not lag. It continues from f, which is moved
+// with ramp_fixed_seek only when it does not stand at sample s of this phase. y is the position
+// itself for a linear ramp (table null), otherwise the table interpolated at the position, or at
+// the mirrored position and flipped when falling; below position 2^rampFineBits the fine table is
+// read instead. The only floating point steps per sample are a multiply and an add. GCC fuses
+// them into a multiply-add on FMA targets unless contraction is off, which the Makefile sets
+// with -ffp-contract=off; the golden tests check the output of the build they run on.
+template <int TableBits>
+inline double ramp_fixed(t_sample *out, const t_sample *in, int n, t_ramp_fixed &f, int s, int phaseSamples, const int32_t *table, const int32_t *fine, bool falling, double start, double range, double gain)
+{
+    const double a = start * gain, b = range * gain * 0x1p-30;
+    int64_t y;
+
+    if (f.length != phaseSamples || f.sample != s)
+        ramp_fixed_seek<TableBits>(f, s, phaseSamples);
+
+    if (!table)
+        y = ramp_fixed_run<TableBits, false, false>(out, in, n, f, table, fine, a, b);
+    else if (falling)
+        y = ramp_fixed_run<TableBits, true, true>(out, in, n, f, table, fine, a, b);
+    else
+        y = ramp_fixed_run<TableBits, true, false>(out, in, n, f, table, fine, a, b);
+
+    const double moved = range * (static_cast<double>(y) * 0x1p-30);
+    return start + moved;
+}
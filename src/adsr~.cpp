@@ -3,286 +3,2590 @@
 
 #include "m_pd.h"
 #include "clamp.h"
+#include "ramp.h"
+#include <atomic>
+#include <climits>
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
+#include <mutex>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#if ADSR_PROFILE
+#include <chrono>
+#endif
+
+// Multichannel signals need Pd 0.54; a weak reference keeps the external loadable in older versions
+#pragma weak signal_setmultiout
 
 static t_class *adsr_tilde_class;
 
 // === ADSR envelope phase enumeration ===
-enum class t_adsr_phase
+enum class t_adsr_phase : unsigned char
 {
     Idle,
     Startup,
     Attack,
     Decay,
     Sustain,
-    Release
+    Release,
+    Segment
+};
+
+// Number of phases, for tables indexed by phase
+const int phaseCount = static_cast<int>(t_adsr_phase::Segment) + 1;
+
+// === Retrigger modes: what a start does to a voice that is not idle ===
+enum class t_adsr_retrigger : unsigned char
+{
+    Reset,     // fades to zero within the startup time, then attacks
+    Continue,  // attacks from the current envelope
+    Legato     // ignored while the gate is held, attacks from the current envelope in the release
 };
 
 // typedef struct enter_phase enter_phase;
 typedef struct t_adsr_tilde t_adsr_tilde;
-typedef void (*adsr_phase_ptr)(t_adsr_tilde *);
+typedef struct t_adsr_voice t_adsr_voice;
+typedef struct t_curve_table t_curve_table;
+typedef struct t_adsr_bank t_adsr_bank;
+typedef struct t_adsr_cached t_adsr_cached;
+typedef int (*adsr_segment_ptr)(t_adsr_tilde *, t_adsr_voice *, t_sample *, int);
+
+// Size of a cache line; the render parameters fill two, each voice one
+const int cacheLine = 64;
+
+// Segment function rendering the running stage of a voice, an index into segmentFuncs
+enum class t_adsr_renderer : unsigned char
+{
+    Idle,
+    Startup,
+    Attack,
+    Decay,
+    Sustain,
+    Hold,
+    Release,
+    Point
+};
+
+// === Envelope state of one voice ===
+// Voices are kept as an array of structures: each renders its own channel of the channel-major
+// output with its own segment function, so its state is read as one line per block rather than
+// one field across all voices per sample. The kernels fill their vector lanes along the time of
+// one voice; lanes across voices would need voices in the same stage and shape and a transpose
+// of every vector into the channels. In make bench a voice sample costs no more with 16 voices
+// than with one in any scenario. The gate level and the reported phase, which are not read
+// while rendering, live in t_adsr_voice_io.
+struct alignas(cacheLine) t_adsr_voice
+{
+    double currentEnv, phaseStartEnv;
+    double knotValue, curveValue, curveStep;
+    double sampleStep;  // 1 / length of the stage, set by enter_phase and stage_length
+    int currentSample, knotSample;
+    int snapSample;  // sample of the release its tail snaps to zero at, see snap_sample
+    t_adsr_phase phase;
+    t_adsr_renderer renderer;
+    unsigned char point;  // breakpoint segment being rendered
+};
+
+static_assert(sizeof(t_adsr_voice) <= cacheLine, "t_adsr_voice must fit into one cache line");
+
+// === Gate input of one voice, the phase its outlet last reported and a stop left over ===
+struct t_adsr_voice_io
+{
+    t_adsr_phase reportedPhase;
+    bool gate;
+    std::atomic<bool> stopPending;  // stop that found the message queue full, see queue_event
+};
+
+// === Scaling of one note by its velocity and key, computed once when it is started ===
+struct t_adsr_note
+{
+    float level;        // envelope level, multiplies the gain
+    float attackScale;  // factor of the attack time
+    float timeScale;    // factor of the decay, release and segment times
+    int attackSamples, decaySamples, releaseSamples;  // scaled stage lengths, see scale_note
+};
+
+// Scaling of starts without velocity and of gate edges
+const t_adsr_note neutralNote = {1.0f, 1.0f, 1.0f, 0, 0, 0};
+
+// === Parameters read while rendering, kept apart from the configuration they are derived from ===
+// The block in dspMemory gives them paramsBytes of their own. Only the breakpoint segments, read
+// while a 'points' list is set, stay in t_adsr_tilde.
+struct t_adsr_params
+{
+    int startupPhaseSamples, attackPhaseSamples, decayPhaseSamples, releasePhaseSamples;
+    int smoothSamples;
+    double sustainLevel, attackShape, releaseShape, gain;
+    const t_curve_table *attackCurve, *releaseCurve;
+    double attackBend, releaseBend;
+    int pointCount, sustainPoint;
+    bool oneShot, exactCurves, singlePrecision, fixedPoint, startAtCurrentEnv, legato, flushDenormals;
+};
+
+// Bytes of the render parameters at the start of the dsp block, whole cache lines
+const int paramsBytes = 2 * cacheLine;
+
+static_assert(sizeof(t_adsr_params) <= paramsBytes, "t_adsr_params must fit into two cache lines");
+
+// Capacity of a breakpoint list
+const int maxPoints = 16;
+
+// === Breakpoint as set by the points message: ramp to level within time ms ===
+struct t_adsr_point
+{
+    double time, level, shape;
+    t_curve_table *curve;
+};
+
+// === Breakpoint segment as rendered ===
+struct t_adsr_segment
+{
+    int samples;
+    double level, shape;
+    const t_curve_table *curve;
+};
+
+// === Parameters as set by messages, handed to the audio thread as one block ===
+struct t_adsr_settings
+{
+    double startupTime, attackTime, decayTime, releaseTime, smoothTime;
+    double sustainLevel, attackShape, releaseShape, gain;
+    t_curve_table *attackCurve, *releaseCurve;  // shared tables of the shapes, null when linear
+    double attackBend, releaseBend;             // curvature of exponential ramps, see exp_curve
+    bool attackExp, releaseExp;                 // exponential instead of power curves
+    t_adsr_point points[maxPoints];
+    int pointCount, sustainPoint;
+    t_adsr_retrigger retrigger;
+    double velocityDepth, velAttackDepth, keyDepth;  // read by start messages only
+    bool oneShot, exactCurves, singlePrecision, fixedPoint, flushDenormals;
+};
+
+// === Render state derived from a settings block at one sample rate ===
+struct t_adsr_baked
+{
+    t_adsr_params params;  // gain is the target a gain change glides to
+    double startupTime, attackTime, decayTime, releaseTime;
+    t_adsr_segment segments[maxPoints];
+};
+
+// === Slot of the settings hand-over, optionally with the block already baked ===
+struct t_adsr_slot
+{
+    t_adsr_settings settings;
+    t_adsr_baked baked;
+    double bakedRate;  // sample rate baked was derived at, 0 when not baked
+};
+
+// === Gate transition found in the signal inlet ===
+struct t_adsr_edge
+{
+    int at;
+    bool rising;
+};
+
+// === start/stop message waiting for its sample in the next block ===
+struct t_adsr_event
+{
+    double time;
+    int at;
+    int first, last;
+    bool start;
+    t_adsr_note note;
+};
+
+// === Signal inlet modulating one parameter ===
+struct t_adsr_mod
+{
+    void (*setter)(t_adsr_tilde *, t_floatarg);
+    const t_sample *in;
+    t_sample *copy;
+    t_sample last;
+    bool connected, varying;
+};
+
+// Modulation inlets in order: attack, decay, sustain, release
+const int modCount = 4;
+
+// Smallest capacity of the per-object message queue; it holds at least two messages per voice
+const int eventQueueSize = 32;
+
+// === DSP cost figures collected in builds with PROFILE=1 ===
+struct t_adsr_stats
+{
+    uint64_t performNs;                // time spent in adsr_perform
+    uint64_t blocks;                   // calls of adsr_perform
+    uint64_t phaseSamples[phaseCount]; // voice samples rendered in each phase
+    uint64_t transitions;              // phase changes of all voices
+};
 
 // === Main object structure ===
+// Fields the perform routine reads on every block come first, configuration and buffers
+// that only change with messages or on dsp follow. The render parameters, the voices, their
+// fixed-point ramp positions, the message queue, the notes and the voice inputs live in one
+// allocation aligned to a cache line (dspMemory, see dsp_block_bytes); the gate edge and
+// modulation buffers are sized by the block and allocated on dsp.
 struct t_adsr_tilde
 {
     t_object x_obj;
-    t_outlet *x_out;
 
-    t_adsr_phase phase;
-    adsr_phase_ptr phaseFunc;
+    // per block
+    t_adsr_params *params;
+    t_adsr_voice *voices;
+    t_ramp_fixed *fixed;  // ramp position of each voice under 'fixed 1'
+    t_adsr_note *notes;  // scaling of the note each voice plays
+    t_adsr_voice_io *voiceIo;
+    t_adsr_edge *gateEdges;
+    int *modChanges;
+    t_adsr_event *events;  // message queue of eventMask + 1 entries
+    const t_sample *vcaIn;  // with -vca, audio input of the voice being rendered, see vca_input
+    t_sample *vcaOut;       // and its output channel
+    int voiceCount, gateChannels, audioChannels, eventMask, modConnected;
+    bool gateScalar, phaseNews;
+
+    // messages queued by the message thread up to eventTail, taken by the perform routine up to
+    // eventHead; both count on and are reduced by eventMask to a position
+    std::atomic<unsigned> eventHead, eventTail;
+    std::atomic<bool> stopsPending;  // some voice has stopPending set
+
+    // configuration
+    t_outlet *x_out, *phaseOut;
+    t_clock *phaseClock;
+    t_float x_f;
+    void *dspMemory;
+    int gateEdgeCapacity, modCapacity;
+    bool vca, modInlets;
+    bool queueFull;  // a start has been dropped since the queue last had room
+    double referenceTime, msPerSample;
     double samplerate, sampleratems;
-    double attackTime, decayTime, sustainLevel, releaseTime;
-    double attackShape, releaseShape;
-    double currentEnv, phaseStartEnv;
-    bool startAtCurrentEnv;
-    int attackPhaseSamples, decayPhaseSamples, releasePhaseSamples, startupPhaseSamples;
-    int currentSample;
-    double gain;
-    bool oneShot = false;
+    double startupTime, attackTime, decayTime, releaseTime;
+    t_adsr_segment segments[maxPoints];  // read while params->pointCount is set
+    double gainTarget, gainStep;
+    int gainRemaining;
+
+    // control rate mode, active with a clock
+    t_clock *controlClock;
+    t_atom *controlList;
+    double controlInterval, controlTime, controlFraction;
+
+    // settings written by the message thread
+    t_adsr_settings control;
+    t_adsr_bank *bank;  // presets, allocated with the first store unless shared with -bank
+    t_symbol *bankName;
+    t_adsr_cached *presetCache;  // presets baked at samplerate, allocated with the first recall
+    t_adsr_slot slots[3];
+    std::atomic<unsigned> slotShared;
+    unsigned slotFront, slotBack;
+
+    t_adsr_mod mods[modCount];
+    t_sample *modBuffer;
+
+#if ADSR_PROFILE
+    t_adsr_stats stats;
+#endif
 };
 
 // Startup time defines the time to move the env to zero in the first step
-const int startupTime = 3;
+const double defaultStartupTime = 3.0;
+
+// A start from at most this level (-100 dB) skips the startup fade: there is nothing to fade out
+const double silenceThreshold = 1e-5;
+
+// A release ends once it falls below this level (-140 dB, beyond the resolution of 24 bit
+// audio). The voice turns idle without rendering the inaudible tail of a strongly shaped
+// curve, and a release from a level already below it never reaches subnormal numbers.
+const double snapThreshold = 1e-7;
+
+// Upper limit for -voices
+const int maxVoices = 1024;
+
+// Shaped ramps are interpolated linearly between exactly computed knots. Knots are at most
+// 1/curveKnots of the ramp apart and at most 1/curveRefine of the distance to the steep end
+// of the curve, which keeps the error below 1.2e-5 of the ramp height for every exponent
+// map_shape_to_exponent produces (0.1 .. 10). Ramps shorter than curveKnots samples are exact.
+const int curveKnots = 1024;
+const int curveRefine = 64;
+
+// Knot values are read from a shared table of curveTableSize intervals where its linear
+// interpolation stays within curveTableError of the curve; closer to the steep end they are
+// computed exactly.
+const int curveTableBits = 12;
+const int curveTableSize = 1 << curveTableBits;
+const double curveTableError = 1e-6;
+
+// === Instrumentation: hooks that compile to nothing without PROFILE=1 ===
+// Helper: start time of a perform call
+inline uint64_t stats_clock()
+{
+#if ADSR_PROFILE
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return 0;
+#endif
+}
+
+// Helper: adds a perform call begun at the given time
+inline void stats_perform(t_adsr_tilde *x, uint64_t begin)
+{
+#if ADSR_PROFILE
+    x->stats.performNs += stats_clock() - begin;
+    ++x->stats.blocks;
+#else
+    (void)x;
+    (void)begin;
+#endif
+}
+
+// Helper: adds samples rendered by a voice in a phase
+inline void stats_samples(t_adsr_tilde *x, t_adsr_phase phase, int n)
+{
+#if ADSR_PROFILE
+    x->stats.phaseSamples[static_cast<int>(phase)] += n;
+#else
+    (void)x;
+    (void)phase;
+    (void)n;
+#endif
+}
+
+// Helper: adds a phase change of a voice
+inline void stats_transition(t_adsr_tilde *x, t_adsr_phase from, t_adsr_phase to)
+{
+#if ADSR_PROFILE
+    x->stats.transitions += from != to;
+#else
+    (void)x;
+    (void)from;
+    (void)to;
+#endif
+}
 
 // Preliminary definition enter_phase
-void enter_phase(t_adsr_tilde *x, t_adsr_phase newPhase);
+void enter_phase(t_adsr_tilde *x, t_adsr_voice *v, t_adsr_phase newPhase);
+
+// Preliminary definition control_advance, which settings changes call at control rate
+void control_advance(t_adsr_tilde *x);
+
+// Preliminary definition rebake_presets, which a new sample rate calls
+void rebake_presets(t_adsr_tilde *x);
+
+// Preliminary definitions of the setters driven by the modulation inlets
+void mod_attack(t_adsr_tilde *x, t_floatarg f);
+void mod_decay(t_adsr_tilde *x, t_floatarg f);
+void mod_sustain(t_adsr_tilde *x, t_floatarg f);
+void mod_release(t_adsr_tilde *x, t_floatarg f);
+
+// Helper: normalised power curve, steep at the start when falling and at the end when rising
+inline double shape_curve(double p, double shape, bool falling)
+{
+    return falling ? 1.0 - std::pow(1.0 - p, shape) : std::pow(p, shape);
+}
 
 // Helper: shaped progress with exponential curvature (linear interpolation)
-double power_lerp(double start, double end, double p, double shape)
+inline double power_lerp(double start, double end, double p, double shape)
 {
     if (shape == 1.0)
         return start + (end - start) * p;
 
-    double curved = (end < start)
-                        ? 1.0 - std::pow(1.0 - p, shape)
-                        : std::pow(p, shape);
+    return start + (end - start) * shape_curve(p, shape, end < start);
+}
+
+// Helper: scaling of the note a voice plays
+inline const t_adsr_note &note_of(const t_adsr_tilde *x, const t_adsr_voice *v);
+
+// Helper: position of the fixed-point ramp of a voice
+inline t_ramp_fixed &fixed_of(t_adsr_tilde *x, const t_adsr_voice *v);
 
-    return start + (end - start) * curved;
+// Helper: stage length scaled for a note; exact for the neutral scale 1
+inline int scaled_samples(int samples, float scale)
+{
+    return static_cast<int>(samples * static_cast<double>(scale));
+}
+
+// Helper: stage lengths of a note under the stage times of p; set when the note starts and
+// whenever a stage time changes, so rendering only reads them
+inline void scale_note(const t_adsr_params &p, t_adsr_note &note)
+{
+    note.attackSamples = scaled_samples(p.attackPhaseSamples, note.attackScale);
+    note.decaySamples = scaled_samples(p.decayPhaseSamples, note.timeScale);
+    note.releaseSamples = scaled_samples(p.releasePhaseSamples, note.timeScale);
 }
 
-void startupPhase(t_adsr_tilde *x)
+// Helper: sets the constants of the running stage for its length
+inline void set_stage_length(t_adsr_voice *v, int samples)
 {
-    double p = static_cast<double>(x->currentSample) / (x->startupPhaseSamples);
-    x->currentEnv = power_lerp(x->phaseStartEnv, 0.0, p, 1.0);
+    v->sampleStep = samples ? 1.0 / samples : 0.0;
+}
+
+// knotSample of a shaped ramp whose length changed: its knots, or the recurrence of an
+// exponential ramp, start over at the current sample
+const int knotResync = INT_MIN;
 
-    if (++x->currentSample >= x->startupPhaseSamples)
+// Helper: returns the length of the running stage, after updating its constants when a message
+// or a modulation inlet changed it. The voice keeps only the reciprocal of the length, which
+// differs for any two lengths an int can hold.
+inline int stage_length(t_adsr_voice *v, int samples)
+{
+    const double step = samples ? 1.0 / samples : 0.0;
+    if (step != v->sampleStep)
     {
-        x->phaseStartEnv = 0.0;
-        enter_phase(x, t_adsr_phase::Attack);
+        v->sampleStep = step;
+        v->knotSample = knotResync;
     }
+    return samples;
 }
 
-void attackPhase(t_adsr_tilde *x)
+// Helper: position of sample s in a stage of phaseSamples samples; the reference engine divides
+inline double stage_position(const t_adsr_tilde *x, const t_adsr_voice *v, int s, int phaseSamples)
 {
-    double p = static_cast<double>(x->currentSample) / (x->attackPhaseSamples);
-    x->currentEnv = power_lerp(x->phaseStartEnv, 1.0, p, x->attackShape);
-
-    if (++x->currentSample >= x->attackPhaseSamples)
-        enter_phase(x, t_adsr_phase::Decay);
+    return x->params->exactCurves ? static_cast<double>(s) / phaseSamples : s * v->sampleStep;
 }
 
-void decayPhase(t_adsr_tilde *x)
+// === Curve tables shared by all instances ===
+// One table of u^exponent per distinct exponent, reference counted by the settings blocks that
+// point to it. Tables are built and freed by the message thread only; the audio thread reads the
+// tables of the settings it received, which the message thread keeps alive until it gets that
+// slot back. Pd instances of libpd may run their message threads in parallel, so the list and
+// the reference counts are changed under curveLock.
+struct t_curve_table
 {
-    double p = static_cast<double>(x->currentSample) / x->decayPhaseSamples;
-    x->currentEnv = (1.0 - p) * (1.0 - x->sustainLevel) + x->sustainLevel;
+    double exponent;
+    double minDistance;  // smallest u the table is accurate at
+    int refs;
+    t_curve_table *next;
+    float values[curveTableSize + 1];
+    int32_t fixedValues[curveTableSize + 1];  // values in Q30, read by ramp_fixed
+    int32_t fixedFine[rampFineSize + 1];      // its first intervals in octaves
+};
+
+static t_curve_table *curveTables;
+static std::mutex curveLock;
+
+// Helper: shared table for an exponent, built on first use; null for the linear exponent 1
+t_curve_table *curve_acquire(double exponent)
+{
+    if (exponent == 1.0)
+        return nullptr;
 
-    if (++x->currentSample >= x->decayPhaseSamples)
+    std::lock_guard<std::mutex> lock(curveLock);
+    t_curve_table *t = curveTables;
+    while (t && t->exponent != exponent)
+        t = t->next;
+
+    if (!t)
     {
-        if (!x->oneShot)
-            enter_phase(x, t_adsr_phase::Sustain);
-        else
-        {
-            x->phaseStartEnv = x->currentEnv;
-            enter_phase(x, t_adsr_phase::Release);
-        }
+        t = (t_curve_table *)getbytes(sizeof(t_curve_table));
+        t->exponent = exponent;
+        for (int i = 0; i <= curveTableSize; ++i)
+            t->values[i] = static_cast<float>(std::pow(static_cast<double>(i) / curveTableSize, exponent));
+        for (int i = 0; i <= curveTableSize; ++i)
+            t->fixedValues[i] = static_cast<int32_t>(std::lrint(std::ldexp(std::pow(static_cast<double>(i) / curveTableSize, exponent), 30)));
+        for (int i = 0; i <= rampFineSize; ++i)
+            t->fixedFine[i] = static_cast<int32_t>(std::lrint(std::ldexp(std::pow(ramp_fine_position(i) / curveTableSize, exponent), 30)));
+
+        // interpolation error h^2/8 * |f''|; for exponents below 2, f'' grows towards u = 0
+        const double h = 1.0 / curveTableSize, bend = std::fabs(exponent * (exponent - 1.0));
+        t->minDistance = exponent < 2.0 ? std::pow(h * h * bend / (8.0 * curveTableError), 1.0 / (2.0 - exponent)) : 0.0;
+        t->next = curveTables;
+        curveTables = t;
     }
+
+    ++t->refs;
+    return t;
 }
 
-void sustainPhase(t_adsr_tilde *x)
+// Helper: adds a reference to a table already held
+inline void curve_retain(t_curve_table *table)
 {
-    x->currentEnv = x->sustainLevel;
+    if (!table)
+        return;
+
+    std::lock_guard<std::mutex> lock(curveLock);
+    ++table->refs;
 }
 
-void releasePhase(t_adsr_tilde *x)
+// Helper: gives up a reference and frees the table with the last one
+void curve_release(t_curve_table *table)
 {
-    double p = static_cast<double>(x->currentSample) / (x->releasePhaseSamples);
-    x->currentEnv = power_lerp(x->phaseStartEnv, 0.0, p, x->releaseShape);
+    if (!table)
+        return;
+
+    std::lock_guard<std::mutex> lock(curveLock);
+    t_curve_table **link = &curveTables;
+    while (*link != table)
+        link = &(*link)->next;
 
-    if (++x->currentSample >= x->releasePhaseSamples)
-        enter_phase(x, t_adsr_phase::Idle);
+    t_curve_table *t = *link;
+    if (--t->refs == 0)
+    {
+        *link = t->next;
+        freebytes(t, sizeof(t_curve_table));
+    }
 }
 
-void idlePhase(t_adsr_tilde *x)
+// Helper: copies a settings block into a slot, moving the slot's table references along
+void hold_settings(t_adsr_settings &slot, const t_adsr_settings &s)
 {
-    x->currentEnv = 0.0;
+    curve_retain(s.attackCurve);
+    curve_retain(s.releaseCurve);
+    for (int i = 0; i < s.pointCount; ++i)
+        curve_retain(s.points[i].curve);
+    curve_release(slot.attackCurve);
+    curve_release(slot.releaseCurve);
+    for (int i = 0; i < slot.pointCount; ++i)
+        curve_release(slot.points[i].curve);
+    slot = s;
 }
 
-// === Enter a new phase and prepare sample counters ===
-void enter_phase(t_adsr_tilde *x, t_adsr_phase newPhase)
+// Helper: points a settings block to the table of a new shape
+void set_curve(t_curve_table *&curve, double exponent)
 {
-    x->phase = newPhase;
+    t_curve_table *old = curve;
+    curve = curve_acquire(exponent);
+    curve_release(old);
+}
 
-    switch (newPhase)
-    {
-    case t_adsr_phase::Startup:
-        x->phaseFunc = startupPhase;
-        break;
+// Helper: shape_curve from the table where it is accurate, exactly computed otherwise
+inline double table_curve(const t_curve_table *t, double p, double shape, bool falling)
+{
+    const double u = falling ? 1.0 - p : p;
+    if (!t || u < t->minDistance)
+        return shape_curve(p, shape, falling);
 
-    case t_adsr_phase::Attack:
-        x->phaseFunc = attackPhase;
-        break;
+    const double at = u * curveTableSize;
+    const int i = std::min(static_cast<int>(at), curveTableSize - 1);
+    const double y = t->values[i] + (at - i) * (t->values[i + 1] - t->values[i]);
+    return falling ? 1.0 - y : y;
+}
 
-    case t_adsr_phase::Decay:
-        x->phaseFunc = decayPhase;
-        break;
+// Curvature of exponential ramps at shape 1 or -1: a ramp that starts steep covers
+// 1 - 1/e (63 %) of its height in the first tenth of its time
+const double maxBend = 10.0;
 
-    case t_adsr_phase::Sustain:
-        x->phaseFunc = sustainPhase;
-        break;
+// Helper: normalised exponential curve, the charge curve of an RC circuit; bend > 0 starts steep
+inline double exp_curve(double p, double bend)
+{
+    return std::expm1(-bend * p) / std::expm1(-bend);
+}
 
-    case t_adsr_phase::Release:
-        x->phaseFunc = releasePhase;
-        break;
+// Helper: samples left in a timed phase, limited to the block; always at least one
+inline int segment_length(const t_adsr_voice *v, int phaseSamples, int n)
+{
+    return std::min(n, std::max(1, phaseSamples - v->currentSample));
+}
 
-    case t_adsr_phase::Idle:
-        x->phaseFunc = idlePhase;
-        break;
+// Helper: computes the next knot of the curve engine for the interval starting at sample s
+void next_knot(t_adsr_voice *v, int s, double shape, const t_curve_table *curve, bool falling, int phaseSamples)
+{
+    int distance = falling ? phaseSamples - s : s;
+    int interval = std::max(1, std::min(phaseSamples / curveKnots, distance / curveRefine));
+    int knot = std::max(s + 1, std::min(phaseSamples, s + interval));
+    double target = table_curve(curve, std::min(1.0, knot * v->sampleStep), shape, falling);
 
-    default:
-        x->phaseFunc = idlePhase;
-        break;
-    }
+    v->curveValue = v->knotValue;
+    v->curveStep = (target - v->knotValue) / (knot - s);
+    v->knotValue = target;
+    v->knotSample = knot;
+}
 
-    x->currentSample = 0;
+// Helper: prepares the one pole recurrence env = env * c + b of an exponential ramp at sample s.
+// While it runs, curveValue holds env, curveStep c, knotValue b and knotSample the negated ramp
+// length the coefficients belong to, so a changed length starts over at the current sample.
+void start_exponential(t_adsr_voice *v, int s, double start, double range, double bend, int phaseSamples)
+{
+    const double target = start - range / std::expm1(-bend);  // level the ramp would settle at
+    v->curveStep = std::exp(-bend / phaseSamples);
+    v->knotValue = -target * std::expm1(-bend / phaseSamples);
+    v->curveValue = start + range * exp_curve(static_cast<double>(s) / phaseSamples, bend);
+    v->knotSample = -phaseSamples;
 }
 
-// === Signal processing function ===
-t_int *adsr_perform(t_int *w)
+// Helper: samples of the audio input matching the output at out while a voice renders with
+// -vca, which the kernels multiply the envelope by; null otherwise
+inline const t_sample *vca_input(const t_adsr_tilde *x, const t_sample *out)
 {
-    t_adsr_tilde *x = (t_adsr_tilde *)(w[1]);
-    t_sample *out = (t_sample *)(w[2]);
-    int n = (int)(w[3]);
+    return x->vcaIn ? x->vcaIn + (out - x->vcaOut) : nullptr;
+}
 
-    while (n--)
+// Helper: renders a shaped ramp from start to end over phaseSamples, continuing at currentSample.
+// A non-zero bend selects an exponential ramp, which starts steep with bend > 0 when falling and
+// with bend < 0 when rising, like power curves with a positive shape.
+int render_ramp(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n, double start, double end, double shape, const t_curve_table *curve, double bend, int phaseSamples)
+{
+    const int len = segment_length(v, phaseSamples, n);
+    const double range = end - start, gain = x->params->gain * note_of(x, v).level;
+    const t_sample *in = vca_input(x, out);
+    int s = v->currentSample;
+    double env = v->currentEnv;
+
+    if (bend != 0.0 && end > start)
+        bend = -bend;
+
+    if (!out)
     {
-        x->phaseFunc(x);
-        *out++ = static_cast<t_sample>(x->currentEnv * x->gain);
+        // control rate: jump to the last sample of the run
+        s += len;
+        const double p = stage_position(x, v, s - 1, phaseSamples);
+        env = bend != 0.0 ? start + range * exp_curve(p, bend) : power_lerp(start, end, p, shape);
+        v->knotSample = 0;
     }
-    return (w + 4);
-}
+    else if (bend != 0.0 && x->params->exactCurves)
+    {
+        for (int i = 0; i < len; ++i, ++s)
+        {
+            env = start + range * exp_curve(static_cast<double>(s) / phaseSamples, bend);
+            ramp_store(out, in, i, static_cast<t_sample>(env * gain));
+        }
+    }
+    else if (bend != 0.0)
+    {
+        if (v->knotSample != -phaseSamples)
+            start_exponential(v, s, start, range, bend, phaseSamples);
 
-// === Trigger methods ===
-void adsr_trigger_start(t_adsr_tilde *x)
-{
-    if (!x->startAtCurrentEnv)
+        v->curveValue = ramp_one_pole(out, in, len, v->curveValue, v->curveStep, v->knotValue, gain);
+        s += len;
+        env = start + range * exp_curve((s - 1) * v->sampleStep, bend);
+    }
+    else if (x->params->fixedPoint)
+    {
+        env = ramp_fixed<curveTableBits>(out, in, len, fixed_of(x, v), s, phaseSamples, curve ? curve->fixedValues : nullptr, curve ? curve->fixedFine : nullptr, end < start, start, range, gain);
+        s += len;
+    }
+    else if (shape == 1.0)
+    {
+        if (x->params->exactCurves)
+            ramp_linear<false>(out, in, len, s, phaseSamples, start, range, gain);
+        else if (x->params->singlePrecision)
+            ramp_linear_single<false>(out, in, len, s, v->sampleStep, start, range, gain);
+        else
+            ramp_linear_step<false>(out, in, len, s, v->sampleStep, start, range, gain);
+        s += len;
+        env = start + range * stage_position(x, v, s - 1, phaseSamples);
+    }
+    else if (x->params->exactCurves)
     {
-        x->phaseStartEnv = x->currentEnv;
-        enter_phase(x, t_adsr_phase::Startup);
+        for (int i = 0; i < len; ++i, ++s)
+        {
+            env = power_lerp(start, end, static_cast<double>(s) / phaseSamples, shape);
+            ramp_store(out, in, i, static_cast<t_sample>(env * gain));
+        }
     }
     else
     {
-        x->phaseStartEnv = x->currentEnv;
-        enter_phase(x, t_adsr_phase::Attack);
+        const bool falling = end < start;
+
+        // after an exponential ramp or a length change the knots continue from the current sample
+        if (v->knotSample < 0)
+        {
+            v->knotValue = shape_curve(static_cast<double>(s) / phaseSamples, shape, falling);
+            v->knotSample = s;
+        }
+
+        for (int i = 0; i < len;)
+        {
+            if (s >= v->knotSample)
+                next_knot(v, s, shape, curve, falling, phaseSamples);
+
+            const int run = std::min(len - i, v->knotSample - s);
+            const double step = v->curveStep;
+            double value = v->curveValue;
+
+            if (x->params->singlePrecision)
+            {
+                ramp_affine(out + i, in ? in + i : nullptr, run, static_cast<t_sample>((start + range * value) * gain), static_cast<t_sample>(range * step * gain));
+                value += step * run;
+                env = start + range * (value - step);
+                i += run;
+            }
+            else
+            {
+                for (int k = 0; k < run; ++k, ++i)
+                {
+                    env = start + range * value;
+                    ramp_store(out, in, i, static_cast<t_sample>(env * gain));
+                    value += step;
+                }
+            }
+
+            v->curveValue = value;
+            s += run;
+        }
     }
+
+    v->currentEnv = env;
+    v->currentSample = s;
+    return len;
 }
 
-void adsr_trigger_stop(t_adsr_tilde *x)
+// Helper: stage lengths scaled for the note a voice plays
+inline int attack_samples(const t_adsr_tilde *x, const t_adsr_voice *v)
 {
-    if (x->oneShot)
-    {
-        return;
-    }
+    return note_of(x, v).attackSamples;
+}
+
+inline int decay_samples(const t_adsr_tilde *x, const t_adsr_voice *v)
+{
+    return note_of(x, v).decaySamples;
+}
+
+inline int release_samples(const t_adsr_tilde *x, const t_adsr_voice *v)
+{
+    return note_of(x, v).releaseSamples;
+}
+
+// Helper: length of breakpoint segment v->point, which must exist
+inline int point_samples(const t_adsr_tilde *x, const t_adsr_voice *v)
+{
+    return scaled_samples(x->segments[v->point].samples, note_of(x, v).timeScale);
+}
+
+// Helper: length of the stage a voice is in; 0 for the phases that do not end on their own
+int stage_samples(const t_adsr_tilde *x, const t_adsr_voice *v)
+{
+    const bool point = v->point < x->params->pointCount;
 
-    if (x->phase != t_adsr_phase::Idle && x->phase != t_adsr_phase::Release)
+    switch (v->phase)
     {
-        x->phaseStartEnv = x->currentEnv;
-        enter_phase(x, t_adsr_phase::Release);
+    case t_adsr_phase::Startup:
+        return x->params->startupPhaseSamples;
+    case t_adsr_phase::Attack:
+        return attack_samples(x, v);
+    case t_adsr_phase::Decay:
+        return decay_samples(x, v);
+    case t_adsr_phase::Release:
+        return point ? point_samples(x, v) : release_samples(x, v);
+    case t_adsr_phase::Segment:
+        return point ? point_samples(x, v) : 0;
+    default:
+        return 0;
     }
 }
 
-// === Parameter setters with clamping ===
-void adsr_attack(t_adsr_tilde *x, t_floatarg f)
+// === Segment renderers: render up to n samples of one phase and return the count ===
+// A stage set to zero length while a voice is in it ends before its next sample
+int startupSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    x->attackTime = clamp(static_cast<double>(f), 0.0, 10000.0);                            // time in milliseconds
-    x->attackPhaseSamples = std::max(1, static_cast<int>(x->attackTime * x->sampleratems)); // Samples to process
+    const int phaseSamples = stage_length(v, x->params->startupPhaseSamples);
+    if (!phaseSamples)
+    {
+        enter_phase(x, v, t_adsr_phase::Startup);
+        return 0;
+    }
+
+    int len = render_ramp(x, v, out, n, v->phaseStartEnv, 0.0, 1.0, nullptr, 0.0, phaseSamples);
+
+    if (v->currentSample >= phaseSamples)
+    {
+        v->phaseStartEnv = 0.0;
+        enter_phase(x, v, t_adsr_phase::Attack);
+    }
+    return len;
 }
 
-void adsr_decay(t_adsr_tilde *x, t_floatarg f)
+int attackSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    x->decayTime = clamp(static_cast<double>(f), 0.0, 10000.0);                           // time in milliseconds
-    x->decayPhaseSamples = std::max(1, static_cast<int>(x->decayTime * x->sampleratems)); // Samples to process
+    const int phaseSamples = stage_length(v, attack_samples(x, v));
+    if (!phaseSamples)
+    {
+        enter_phase(x, v, t_adsr_phase::Attack);
+        return 0;
+    }
+
+    int len = render_ramp(x, v, out, n, v->phaseStartEnv, 1.0, x->params->attackShape, x->params->attackCurve, x->params->attackBend, phaseSamples);
+
+    if (v->currentSample >= phaseSamples)
+        enter_phase(x, v, t_adsr_phase::Decay);
+    return len;
 }
 
-void adsr_release(t_adsr_tilde *x, t_floatarg f)
+int decaySegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    double t = (!x->startAtCurrentEnv) ? startupTime : 0;
-    x->releaseTime = clamp(static_cast<double>(f - t), 0.0, 10000.0);                         // time in milliseconds
-    x->releasePhaseSamples = std::max(1, static_cast<int>(x->releaseTime * x->sampleratems)); // Samples to process
+    const t_adsr_note &note = note_of(x, v);
+    const int phaseSamples = stage_length(v, decay_samples(x, v));
+    if (!phaseSamples)
+    {
+        enter_phase(x, v, t_adsr_phase::Decay);
+        return 0;
+    }
+
+    const int len = segment_length(v, phaseSamples, n);
+    const double sustain = x->params->sustainLevel, range = 1.0 - sustain, gain = x->params->gain * note.level;
+    const int s = v->currentSample + len;
+
+    if (out)
+    {
+        if (x->params->exactCurves)
+            ramp_linear<true>(out, vca_input(x, out), len, v->currentSample, phaseSamples, sustain, range, gain);
+        else if (x->params->fixedPoint)
+            ramp_fixed<curveTableBits>(out, vca_input(x, out), len, fixed_of(x, v), v->currentSample, phaseSamples, nullptr, nullptr, true, 1.0, -range, gain);
+        else if (x->params->singlePrecision)
+            ramp_linear_single<true>(out, vca_input(x, out), len, v->currentSample, v->sampleStep, sustain, range, gain);
+        else
+            ramp_linear_step<true>(out, vca_input(x, out), len, v->currentSample, v->sampleStep, sustain, range, gain);
+    }
+
+    v->currentEnv = (1.0 - stage_position(x, v, s - 1, phaseSamples)) * range + sustain;
+    v->currentSample = s;
+
+    if (s >= phaseSamples)
+    {
+        if (!x->params->oneShot)
+            enter_phase(x, v, t_adsr_phase::Sustain);
+        else
+        {
+            v->phaseStartEnv = v->currentEnv;
+            enter_phase(x, v, t_adsr_phase::Release);
+        }
+    }
+    return len;
 }
 
-void adsr_sustain(t_adsr_tilde *x, t_floatarg f)
+// Helper: holds a constant level for the whole run in one bulk fill
+inline int hold_level(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n, double level)
 {
-    x->sustainLevel = clamp(static_cast<double>(f), 0.0, 1.0); // level in [0..1]
+    v->currentEnv = level;
+    if (!out)
+        return n;
+
+    const t_sample value = static_cast<t_sample>(level * x->params->gain * note_of(x, v).level);
+    if (const t_sample *in = vca_input(x, out))
+        std::transform(in, in + n, out, [value](t_sample f) { return value * f; });
+    else
+        std::fill_n(out, n, value);
+    return n;
 }
 
-double map_shape_to_exponent(double f)
+// Sustain glides to a changed level within smoothSamples. While gliding, knotValue holds the
+// target, curveStep the change per sample and knotSample the samples left.
+int sustainSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    double shape = clamp(f, -1.0, 1.0);
-    return (shape < 0.0) ? 1.0 + shape * 0.9 : 1.0 + shape * 9.0;
+    const double target = x->params->sustainLevel;
+
+    if (v->currentEnv != target && x->params->smoothSamples && (v->knotSample == 0 || v->knotValue != target))
+    {
+        v->knotValue = target;
+        v->knotSample = x->params->smoothSamples;
+        v->curveStep = (target - v->currentEnv) / x->params->smoothSamples;
+    }
+
+    if (v->knotSample == 0)
+        return hold_level(x, v, out, n, target);
+
+    const int run = std::min(n, v->knotSample);
+    const double gain = x->params->gain * note_of(x, v).level;
+    if (out)
+        ramp_affine_double(out, vca_input(x, out), run, (v->currentEnv + v->curveStep) * gain, v->curveStep * gain);
+
+    v->knotSample -= run;
+    v->currentEnv = v->knotSample ? v->currentEnv + v->curveStep * run : target;
+    return run;
 }
 
-void adsr_attackshape(t_adsr_tilde *x, t_floatarg f)
+// Helper: share of a release from level start (at the outlet, before the gain) that stays
+// above snapThreshold. A power curve falls as start * (1 - p)^shape. The exponential curve
+// ends at a slope that keeps it far above the threshold, unless it starts there.
+double snap_fraction(const t_adsr_tilde *x, double start)
 {
-    x->attackShape = map_shape_to_exponent(f);
+    if (start <= snapThreshold)
+        return 0.0;
+    if (x->params->releaseBend != 0.0)
+        return 1.0;
+    return 1.0 - std::pow(snapThreshold / start, 1.0 / x->params->releaseShape);
 }
 
-void adsr_releaseshape(t_adsr_tilde *x, t_floatarg f)
+// Helper: sample of the release a voice is in at which its tail snaps to zero, at most the
+// length of the release. Computed in double when the release starts, its curve or its length
+// changes; a float fraction would round past the end of releases over 2^24 samples.
+int snap_sample(const t_adsr_tilde *x, const t_adsr_voice *v)
 {
-    x->releaseShape = map_shape_to_exponent(f);
+    const int phaseSamples = release_samples(x, v);
+    const double snap = std::ceil(snap_fraction(x, v->phaseStartEnv * note_of(x, v).level) * phaseSamples);
+    return static_cast<int>(std::min(snap, static_cast<double>(phaseSamples)));
 }
 
-void adsr_g(t_adsr_tilde *x, t_floatarg f)
+int releaseSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    x->gain = clampmin(static_cast<double>(f), 0.0);
+    const double step = v->sampleStep;
+    const int phaseSamples = stage_length(v, release_samples(x, v));
+    if (!phaseSamples)
+    {
+        enter_phase(x, v, t_adsr_phase::Release);
+        return 0;
+    }
+
+    // the tail below snapThreshold is not rendered
+    if (v->sampleStep != step)
+        v->snapSample = snap_sample(x, v);
+    const int snap = v->snapSample;
+    if (v->currentSample >= snap)
+    {
+        v->currentEnv = 0.0;
+        enter_phase(x, v, t_adsr_phase::Idle);
+        return 0;
+    }
+
+    int len = render_ramp(x, v, out, std::min(n, snap - v->currentSample), v->phaseStartEnv, 0.0, x->params->releaseShape, x->params->releaseCurve, x->params->releaseBend, phaseSamples);
+
+    if (v->currentSample >= snap)
+        enter_phase(x, v, t_adsr_phase::Idle);
+    return len;
 }
 
-void adsr_oneshot(t_adsr_tilde *x, t_floatarg f)
+int idleSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    x->oneShot = f != 0.0;
+    return hold_level(x, v, out, n, 0.0);
 }
 
-void adsr_dsp(t_adsr_tilde *x, t_signal **sp)
+// Helper: ends breakpoint segment v->point at its level and returns the phase that follows:
+// the next segment, the hold at the sustain point (passed with oneshot) or the end of the list
+t_adsr_phase next_point(t_adsr_tilde *x, t_adsr_voice *v, t_adsr_phase phase)
 {
-    x->samplerate = sp[0]->s_sr;
-    x->sampleratems = x->samplerate / 1000;
-    x->startupPhaseSamples = std::max(1, static_cast<int>(startupTime * x->sampleratems));
-    dsp_add(adsr_perform, 3, x, sp[0]->s_vec, sp[0]->s_n);
+    v->currentEnv = v->phaseStartEnv = x->segments[v->point++].level;
+
+    if (phase == t_adsr_phase::Segment && v->point == x->params->sustainPoint)
+        return x->params->oneShot ? t_adsr_phase::Release : t_adsr_phase::Sustain;
+    if (v->point >= x->params->pointCount)
+        return t_adsr_phase::Idle;
+    return phase;
 }
 
-// === Object constructor ===
-void *adsr_new(t_floatarg f)
+// Breakpoint segments before the sustain point run as Segment, those after it as Release
+int pointSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
 {
-    t_adsr_tilde *x = (t_adsr_tilde *)pd_new(adsr_tilde_class);
-    x->x_out = outlet_new(&x->x_obj, &s_signal);
-
-    x->startAtCurrentEnv = f == 1.0;
-    x->samplerate = 44100.0;
-    x->sampleratems = 44.1;
-    x->attackTime = 0.01;
-    x->decayTime = 0.1;
-    x->sustainLevel = 0.7;
-    x->releaseTime = 0.2;
-    x->attackShape = 2.0;
-    x->releaseShape = 1.0;
-    x->currentEnv = 0.0;
-    x->gain = 1.0;
-    x->phaseFunc = idlePhase;
-    x->phase = t_adsr_phase::Idle;
+    // a shortened list ends the segments with the release set by messages
+    if (v->point >= x->params->pointCount)
+    {
+        v->phaseStartEnv = v->currentEnv;
+        enter_phase(x, v, t_adsr_phase::Release);
+        return 0;
+    }
+
+    const t_adsr_segment &seg = x->segments[v->point];
+    const int phaseSamples = stage_length(v, point_samples(x, v));
+    if (!phaseSamples)
+    {
+        enter_phase(x, v, v->phase);
+        return 0;
+    }
+
+    int len = render_ramp(x, v, out, n, v->phaseStartEnv, seg.level, seg.shape, seg.curve, 0.0, phaseSamples);
+
+    if (v->currentSample >= phaseSamples)
+        enter_phase(x, v, next_point(x, v, v->phase));
+    return len;
+}
+
+// Sustain point of a breakpoint list: holds the level of the point
+int holdSegment(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
+{
+    return hold_level(x, v, out, n, v->currentEnv);
+}
+
+// Segment functions in the order of t_adsr_renderer
+const adsr_segment_ptr segmentFuncs[] = {idleSegment, startupSegment, attackSegment, decaySegment, sustainSegment, holdSegment, releaseSegment, pointSegment};
+
+// === Enter a new phase and prepare sample counters ===
+// Stages shorter than one sample are passed at once: the voice takes their end level and
+// goes on to the following stage, so 0 ms attack and decay reach Sustain on the same sample.
+// With a breakpoint list, the list takes the place of attack and decay, and the segments
+// after the sustain point take the place of the release.
+void enter_phase(t_adsr_tilde *x, t_adsr_voice *v, t_adsr_phase newPhase)
+{
+    const bool points = x->params->pointCount > 0;
+
+    for (;;)
+    {
+        if (newPhase == t_adsr_phase::Attack && points)
+        {
+            v->point = 0;
+            newPhase = t_adsr_phase::Segment;
+        }
+
+        if (newPhase == t_adsr_phase::Startup && !x->params->startupPhaseSamples)
+        {
+            v->currentEnv = v->phaseStartEnv = 0.0;
+            newPhase = t_adsr_phase::Attack;
+        }
+        else if (newPhase == t_adsr_phase::Attack && !attack_samples(x, v))
+        {
+            v->currentEnv = 1.0;
+            newPhase = t_adsr_phase::Decay;
+        }
+        else if (newPhase == t_adsr_phase::Decay && !decay_samples(x, v))
+        {
+            v->currentEnv = x->params->sustainLevel;
+            if (x->params->oneShot)
+            {
+                v->phaseStartEnv = v->currentEnv;
+                newPhase = t_adsr_phase::Release;
+            }
+            else
+                newPhase = t_adsr_phase::Sustain;
+        }
+        else if ((newPhase == t_adsr_phase::Segment || newPhase == t_adsr_phase::Release) && v->point < x->params->pointCount && !point_samples(x, v))
+        {
+            newPhase = next_point(x, v, newPhase);
+        }
+        else if (newPhase == t_adsr_phase::Release && v->point >= x->params->pointCount && !release_samples(x, v))
+        {
+            v->currentEnv = 0.0;
+            newPhase = t_adsr_phase::Idle;
+        }
+        else
+            break;
+    }
+
+    stats_transition(x, v->phase, newPhase);
+    v->phase = newPhase;
+    x->phaseNews = true;
+
+    switch (newPhase)
+    {
+    case t_adsr_phase::Startup:
+        v->renderer = t_adsr_renderer::Startup;
+        break;
+
+    case t_adsr_phase::Attack:
+        v->renderer = t_adsr_renderer::Attack;
+        break;
+
+    case t_adsr_phase::Decay:
+        v->renderer = t_adsr_renderer::Decay;
+        break;
+
+    case t_adsr_phase::Sustain:
+        v->renderer = points ? t_adsr_renderer::Hold : t_adsr_renderer::Sustain;
+        break;
+
+    case t_adsr_phase::Release:
+        v->renderer = v->point < x->params->pointCount ? t_adsr_renderer::Point : t_adsr_renderer::Release;
+        v->snapSample = snap_sample(x, v);
+        break;
+
+    case t_adsr_phase::Segment:
+        v->renderer = t_adsr_renderer::Point;
+        break;
+
+    case t_adsr_phase::Idle:
+        v->renderer = t_adsr_renderer::Idle;
+        break;
+
+    default:
+        v->renderer = t_adsr_renderer::Idle;
+        break;
+    }
+
+    v->currentSample = 0;
+    v->knotSample = 0;
+    v->knotValue = 0.0;
+    const int samples = stage_samples(x, v);
+    set_stage_length(v, samples);
+
+    // the divisions of a fixed-point ramp happen here once per stage, not on every block
+    if (x->params->fixedPoint && samples)
+        ramp_fixed_seek<curveTableBits>(fixed_of(x, v), 0, samples);
+}
+
+// === Render one voice as a run of phase segments ===
+// Without an output vector the voice only advances by n samples (control rate mode)
+void render_voice(t_adsr_tilde *x, t_adsr_voice *v, t_sample *out, int n)
+{
+    // Idle and Sustain never end on their own, so the whole block is one constant fill
+    if (v->phase == t_adsr_phase::Idle)
+    {
+        stats_samples(x, v->phase, n);
+        hold_level(x, v, out, n, 0.0);
+        return;
+    }
+    if (v->phase == t_adsr_phase::Sustain && v->currentEnv == x->params->sustainLevel && v->knotSample == 0)
+    {
+        stats_samples(x, v->phase, n);
+        hold_level(x, v, out, n, x->params->sustainLevel);
+        return;
+    }
+
+    while (n > 0)
+    {
+        const t_adsr_phase phase = v->phase;
+        int done = segmentFuncs[static_cast<int>(v->renderer)](x, v, out, n);
+        stats_samples(x, phase, done);
+        if (out)
+            out += done;
+        n -= done;
+    }
+}
+
+// === Trigger methods ===
+inline const t_adsr_note &note_of(const t_adsr_tilde *x, const t_adsr_voice *v)
+{
+    return x->notes[v - x->voices];
+}
+
+inline t_ramp_fixed &fixed_of(t_adsr_tilde *x, const t_adsr_voice *v)
+{
+    return x->fixed[v - x->voices];
+}
+
+// Helper: scales the stage lengths of every voice's note again after a stage time changed
+void rescale_notes(t_adsr_tilde *x)
+{
+    for (int i = 0; i < x->voiceCount; ++i)
+        scale_note(*x->params, x->notes[i]);
+}
+
+void voice_start(t_adsr_tilde *x, t_adsr_voice *v, const t_adsr_note &note)
+{
+    // legato: a start while the gate is held leaves the voice alone
+    if (x->params->legato && v->phase != t_adsr_phase::Idle && v->phase != t_adsr_phase::Release)
+        return;
+
+    // the envelope continues from the level at the outlet under the new note's scaling, up to
+    // the peak of the new note
+    t_adsr_note &current = x->notes[v - x->voices];
+    if (current.level != note.level)
+        v->currentEnv = std::min(1.0, v->currentEnv * current.level / note.level);
+    current = note;
+    scale_note(*x->params, current);
+
+    if (!x->params->startAtCurrentEnv && v->currentEnv <= silenceThreshold)
+    {
+        // nothing to fade out, the attack starts at once
+        v->phaseStartEnv = 0.0;
+        enter_phase(x, v, t_adsr_phase::Attack);
+    }
+    else if (!x->params->startAtCurrentEnv)
+    {
+        v->phaseStartEnv = v->currentEnv;
+        enter_phase(x, v, t_adsr_phase::Startup);
+    }
+    else
+    {
+        v->phaseStartEnv = v->currentEnv;
+        enter_phase(x, v, t_adsr_phase::Attack);
+    }
+}
+
+void voice_stop(t_adsr_tilde *x, t_adsr_voice *v)
+{
+    if (x->params->oneShot)
+    {
+        return;
+    }
+
+    if (v->phase != t_adsr_phase::Idle && v->phase != t_adsr_phase::Release)
+    {
+        // a breakpoint list continues after its sustain point, or with the release without one
+        v->point = x->params->sustainPoint ? x->params->sustainPoint : x->params->pointCount;
+        v->phaseStartEnv = v->currentEnv;
+        enter_phase(x, v, t_adsr_phase::Release);
+    }
+}
+
+// === Gate signal: rising edges start, falling edges stop on the exact sample ===
+// Helper: collects the transitions of one gate channel, starting from the given state
+int scan_gate(t_adsr_tilde *x, const t_sample *in, int n, bool high)
+{
+    int count = 0;
+
+    // an unconnected inlet carries one scalar for the whole block
+    if (x->gateScalar)
+        n = 1;
+
+    for (int i = 0; i < n; ++i)
+    {
+        if ((in[i] > 0) != high)
+        {
+            high = !high;
+            x->gateEdges[count++] = {i, high};
+        }
+    }
+    return count;
+}
+
+// === Timestamped messages: start/stop land on the sample matching their logical time ===
+// Helper: applies a queued start or stop to its range of voices
+void apply_event(t_adsr_tilde *x, const t_adsr_event &e)
+{
+    for (int i = e.first; i < e.last; ++i)
+    {
+        if (e.start)
+            voice_start(x, &x->voices[i], e.note);
+        else
+            voice_stop(x, &x->voices[i]);
+    }
+}
+
+// Helper: message thread side, appends e to the queue unless it is full
+bool push_event(t_adsr_tilde *x, const t_adsr_event &e)
+{
+    const unsigned tail = x->eventTail.load(std::memory_order_relaxed);
+    if (tail - x->eventHead.load(std::memory_order_acquire) > static_cast<unsigned>(x->eventMask))
+        return false;
+
+    x->events[tail & x->eventMask] = e;
+    x->eventTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Helper: message thread side, moves the stops left over into the queue as messages at time.
+// Returns false if the queue fills up first. Either side takes a stop with an exchange, so it
+// applies once.
+bool queue_pending_stops(t_adsr_tilde *x, double time)
+{
+    if (!x->stopsPending.exchange(false, std::memory_order_acquire))
+        return true;
+
+    for (int i = 0; i < x->voiceCount; ++i)
+    {
+        std::atomic<bool> &pending = x->voiceIo[i].stopPending;
+        if (!pending.load(std::memory_order_relaxed))
+            continue;
+        if (x->eventTail.load(std::memory_order_relaxed) - x->eventHead.load(std::memory_order_acquire) > static_cast<unsigned>(x->eventMask))
+        {
+            x->stopsPending.store(true, std::memory_order_release);
+            return false;
+        }
+        if (pending.exchange(false, std::memory_order_acq_rel))
+            push_event(x, {time, 0, i, i + 1, false, neutralNote});
+    }
+    return true;
+}
+
+// Helper: message thread side, queues a message with the current logical time. The queue is a
+// single producer, single consumer ring: voices are only touched by the perform routine, with
+// the parameters it holds. While DSP is off the messages wait in the queue, and the first block
+// applies them on its first sample. A start that finds the queue full is dropped. A stop is kept
+// in the voices it addresses instead, so no voice is held forever; perform applies it once the
+// queue has run empty, unless the next message queues it first. Nothing newer than a stop left
+// over is queued before it, so the order of messages to a voice holds.
+void queue_event(t_adsr_tilde *x, int first, int last, bool start, const t_adsr_note &note)
+{
+    const double time = clock_gettimesince(x->referenceTime);
+    if (queue_pending_stops(x, time) && push_event(x, {time, 0, first, last, start, note}))
+    {
+        x->queueFull = false;
+        return;
+    }
+
+    if (!x->queueFull)
+        pd_error(x, "adsr~: %d messages wait for the next block, dropping starts", x->eventMask + 1);
+    x->queueFull = true;
+    if (start)
+        return;
+    for (int i = first; i < last; ++i)
+        x->voiceIo[i].stopPending.store(true, std::memory_order_relaxed);
+    x->stopsPending.store(true, std::memory_order_release);
+}
+
+// Helper: audio thread side, applies the stops left over once every queued message is applied
+void apply_pending_stops(t_adsr_tilde *x)
+{
+    if (x->eventHead.load(std::memory_order_relaxed) != x->eventTail.load(std::memory_order_acquire) ||
+        !x->stopsPending.exchange(false, std::memory_order_acquire))
+        return;
+
+    for (int i = 0; i < x->voiceCount; ++i)
+    {
+        if (x->voiceIo[i].stopPending.exchange(false, std::memory_order_acq_rel))
+            voice_stop(x, &x->voices[i]);
+    }
+}
+
+// Helper: queued message q, counted from the oldest one
+inline t_adsr_event &queued_event(const t_adsr_tilde *x, int q)
+{
+    return x->events[(x->eventHead.load(std::memory_order_relaxed) + q) & x->eventMask];
+}
+
+// Helper: audio thread side, gives the queued messages due in this block their sample offset and
+// returns their count. perform runs at the logical time the block ends at, after the clocks before
+// it fired, so the block covers [now - n, now): a message at time t lands on the sample t falls
+// in, one sent between two ticks on sample 0. This adds no latency, where vline~ schedules over
+// [now, now + n), one block later.
+int due_events(t_adsr_tilde *x, int n)
+{
+    const int queued = static_cast<int>(x->eventTail.load(std::memory_order_acquire) - x->eventHead.load(std::memory_order_relaxed));
+    if (!queued)
+        return 0;
+
+    double blockStart = clock_gettimesince(x->referenceTime) - n * x->msPerSample;
+    int count = 0;
+
+    for (; count < queued; ++count)
+    {
+        t_adsr_event &e = queued_event(x, count);
+        double offset = std::floor((e.time - blockStart) / x->msPerSample);
+        if (offset >= n)
+            break;
+        e.at = std::max(0, static_cast<int>(offset));
+    }
+    return count;
+}
+
+// Helper: next due message addressing the voice, starting the search at queue position q
+const t_adsr_event *next_event(const t_adsr_tilde *x, int voice, int &q, int dueCount)
+{
+    for (; q < dueCount; ++q)
+    {
+        const t_adsr_event &e = queued_event(x, q);
+        if (voice >= e.first && voice < e.last)
+        {
+            ++q;
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+// === Parameter conversion shared by messages and modulation inlets ===
+// Helper: stage time in milliseconds as accepted by the setters
+inline double stage_time(double f)
+{
+    return clamp(f, 0.0, 10000.0);
+}
+
+// Helper: release time without the startup fade, which a retrigger adds in front of the attack
+inline double release_time(const t_adsr_tilde *x, double f)
+{
+    double t = (!x->params->startAtCurrentEnv) ? x->startupTime : 0;
+    return stage_time(f - t);
+}
+
+// Helper: samples of a stage at the current sample rate; 0 makes enter_phase skip the stage
+inline int phase_samples(const t_adsr_tilde *x, double ms)
+{
+    return static_cast<int>(ms * x->sampleratems);
+}
+
+// === Lock-free hand-over of the settings from the message thread to the audio thread ===
+// A triple buffer: the message thread fills slots[slotBack] and swaps it into the shared slot,
+// the audio thread swaps the shared slot with slots[slotFront] at block start when it holds
+// news. Neither side waits or allocates, and a block is always applied as a whole.
+const unsigned slotFresh = 4;
+
+// Helper: brings voices in a shaped stage to curves or an engine changed while they run: the
+// knots start over at the current sample and a release finds the sample its tail snaps at anew
+void reshape_voices(t_adsr_tilde *x)
+{
+    for (int i = 0; i < x->voiceCount; ++i)
+    {
+        t_adsr_voice *v = &x->voices[i];
+        if (v->phase != t_adsr_phase::Attack && v->phase != t_adsr_phase::Release && v->phase != t_adsr_phase::Segment)
+            continue;
+
+        v->knotSample = knotResync;
+        if (v->phase == t_adsr_phase::Release && v->point >= x->params->pointCount)
+            v->snapSample = snap_sample(x, v);
+    }
+}
+
+// Helper: converts a settings block into the render state at the current sample rate
+void bake_settings(const t_adsr_tilde *x, const t_adsr_settings &s, t_adsr_baked &b)
+{
+    // a retrigger adds the startup fade in front of the attack, the release leaves it out
+    const double fade = s.retrigger == t_adsr_retrigger::Reset ? s.startupTime : 0.0;
+
+    b.params.startAtCurrentEnv = s.retrigger != t_adsr_retrigger::Reset;
+    b.params.legato = s.retrigger == t_adsr_retrigger::Legato;
+    b.startupTime = s.startupTime;
+    b.attackTime = s.attackTime;
+    b.decayTime = s.decayTime;
+    b.releaseTime = s.releaseTime;
+    b.params.startupPhaseSamples = phase_samples(x, s.startupTime);
+    b.params.attackPhaseSamples = phase_samples(x, s.attackTime);
+    b.params.decayPhaseSamples = phase_samples(x, s.decayTime);
+    b.params.releasePhaseSamples = phase_samples(x, stage_time(s.releaseTime - fade));
+    b.params.smoothSamples = static_cast<int>(s.smoothTime * x->sampleratems);
+    b.params.sustainLevel = s.sustainLevel;
+    b.params.attackShape = s.attackShape;
+    b.params.releaseShape = s.releaseShape;
+    b.params.gain = s.gain;
+    b.params.attackCurve = s.attackCurve;
+    b.params.releaseCurve = s.releaseCurve;
+    b.params.attackBend = s.attackExp ? s.attackBend : 0.0;
+    b.params.releaseBend = s.releaseExp ? s.releaseBend : 0.0;
+    for (int i = 0; i < s.pointCount; ++i)
+        b.segments[i] = {phase_samples(x, s.points[i].time), s.points[i].level, s.points[i].shape, s.points[i].curve};
+    b.params.pointCount = s.pointCount;
+    b.params.sustainPoint = std::min(s.sustainPoint, s.pointCount);
+    b.params.oneShot = s.oneShot;
+    b.params.exactCurves = s.exactCurves;
+    b.params.singlePrecision = s.singlePrecision;
+    b.params.fixedPoint = s.fixedPoint && !s.exactCurves;
+    b.params.flushDenormals = s.flushDenormals;
+}
+
+// Helper: makes a baked render state the one the audio thread renders with
+void apply_baked(t_adsr_tilde *x, const t_adsr_baked &b)
+{
+    const t_adsr_params &p = b.params;
+    const bool reshaped = p.attackShape != x->params->attackShape || p.releaseShape != x->params->releaseShape ||
+                          p.attackBend != x->params->attackBend || p.releaseBend != x->params->releaseBend ||
+                          p.exactCurves != x->params->exactCurves || p.singlePrecision != x->params->singlePrecision ||
+                          p.fixedPoint != x->params->fixedPoint || p.pointCount || x->params->pointCount;
+
+    const double gain = x->params->gain;
+    *x->params = p;
+    x->params->gain = gain;
+    x->startupTime = b.startupTime;
+    x->attackTime = b.attackTime;
+    x->decayTime = b.decayTime;
+    x->releaseTime = b.releaseTime;
+    std::copy(b.segments, b.segments + p.pointCount, x->segments);
+
+    // a new gain glides there within smoothSamples, see glide_gain
+    if (!p.smoothSamples)
+    {
+        x->params->gain = x->gainTarget = p.gain;
+        x->gainRemaining = 0;
+    }
+    else if (p.gain != x->gainTarget)
+    {
+        x->gainTarget = p.gain;
+        x->gainRemaining = p.smoothSamples;
+        x->gainStep = (p.gain - gain) / p.smoothSamples;
+    }
+    rescale_notes(x);
+    if (reshaped)
+        reshape_voices(x);
+
+    // connected modulation inlets take over again with their next value
+    for (t_adsr_mod &m : x->mods)
+        m.last = NAN;
+}
+
+// Helper: converts a settings block into the render parameters used by the audio thread
+void apply_settings(t_adsr_tilde *x, const t_adsr_settings &s)
+{
+    t_adsr_baked b;
+    bake_settings(x, s, b);
+    apply_baked(x, b);
+}
+
+// Helper: bakes the stage lengths and all other rate dependent constants of the settings the
+// audio thread holds for a new sample rate; dsp and the constructor call it, so the perform
+// routine never converts
+void set_samplerate(t_adsr_tilde *x, double sr)
+{
+    const bool changed = sr != x->samplerate;
+    x->samplerate = sr;
+    x->sampleratems = sr / 1000;
+    x->msPerSample = 1.0 / x->sampleratems;
+    apply_settings(x, x->slots[x->slotFront].settings);
+    if (changed)
+        rebake_presets(x);
+}
+
+// Helper: message thread side, publishes the current settings, with their render state when the
+// caller baked it already
+void publish_settings(t_adsr_tilde *x, const t_adsr_baked *baked = nullptr)
+{
+    // at control rate, the time up to the change still runs with the old settings
+    if (x->controlClock)
+        control_advance(x);
+
+    t_adsr_slot &slot = x->slots[x->slotBack];
+    hold_settings(slot.settings, x->control);
+    slot.bakedRate = baked ? x->samplerate : 0.0;
+    if (baked)
+        slot.baked = *baked;
+    x->slotBack = x->slotShared.exchange(x->slotBack | slotFresh, std::memory_order_acq_rel) & ~slotFresh;
+}
+
+// Helper: audio thread side, applies the settings published since the last block
+void receive_settings(t_adsr_tilde *x)
+{
+    if (!(x->slotShared.load(std::memory_order_relaxed) & slotFresh))
+        return;
+
+    x->slotFront = x->slotShared.exchange(x->slotFront, std::memory_order_acq_rel) & ~slotFresh;
+
+    // a block baked at another sample rate than the current one is converted again
+    const t_adsr_slot &slot = x->slots[x->slotFront];
+    if (slot.bakedRate == x->samplerate)
+        apply_baked(x, slot.baked);
+    else
+        apply_settings(x, slot.settings);
+}
+
+// === Modulation inlets: parameter work only happens when a connected input changes ===
+// Helper: applies constant inputs once, copies varying ones and returns the samples where they change.
+// Copies keep the values safe when an input shares memory with the output.
+int scan_modulation(t_adsr_tilde *x, int n)
+{
+    int varying = 0;
+
+    for (t_adsr_mod &m : x->mods)
+    {
+        if (!m.connected)
+            continue;
+
+        const t_sample first = m.in[0];
+        m.varying = std::any_of(m.in + 1, m.in + n, [first](t_sample f) { return f != first; });
+
+        if (m.varying)
+        {
+            std::copy(m.in, m.in + n, m.copy);
+            ++varying;
+        }
+        else if (first != m.last)
+        {
+            m.last = first;
+            m.setter(x, first);
+        }
+    }
+
+    if (!varying)
+        return 0;
+
+    int count = 0;
+    for (int i = 1; i < n; ++i)
+    {
+        for (const t_adsr_mod &m : x->mods)
+        {
+            if (m.varying && m.copy[i] != m.copy[i - 1])
+            {
+                x->modChanges[count++] = i;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+// Helper: brings the varying inputs to their values at sample i
+void apply_modulation(t_adsr_tilde *x, int i)
+{
+    for (t_adsr_mod &m : x->mods)
+    {
+        if (m.varying && m.copy[i] != m.last)
+        {
+            m.last = m.copy[i];
+            m.setter(x, m.last);
+        }
+    }
+}
+
+// Helper: renders one voice in spans between parameter changes, gate transitions and due messages.
+// At a shared sample, parameters change first, then messages apply, then the gate.
+void render_voice_events(t_adsr_tilde *x, int voice, t_sample *out, int n, int edgeCount, int dueCount, int changeCount)
+{
+    t_adsr_voice *v = &x->voices[voice];
+    int pos = 0, e = 0, q = 0, c = 0;
+    const t_adsr_event *msg = next_event(x, voice, q, dueCount);
+
+    // every voice renders from the start of the block with the parameters found there
+    if (changeCount)
+        apply_modulation(x, 0);
+
+    for (;;)
+    {
+        int atChange = c < changeCount ? x->modChanges[c] : n;
+        int atMsg = msg ? msg->at : n;
+        int atEdge = e < edgeCount ? x->gateEdges[e].at : n;
+        int at = std::min(atChange, std::min(atMsg, atEdge));
+        if (at >= n)
+            break;
+
+        render_voice(x, v, out + pos, at - pos);
+        pos = at;
+
+        if (atChange == at)
+        {
+            apply_modulation(x, x->modChanges[c++]);
+        }
+        else if (atMsg == at)
+        {
+            if (msg->start)
+                voice_start(x, v, msg->note);
+            else
+                voice_stop(x, v);
+            msg = next_event(x, voice, q, dueCount);
+        }
+        else
+        {
+            x->voiceIo[voice].gate = x->gateEdges[e++].rising;
+            if (x->voiceIo[voice].gate)
+                voice_start(x, v, neutralNote);
+            else
+                voice_stop(x, v);
+        }
+    }
+
+    render_voice(x, v, out + pos, n - pos);
+}
+
+// === Phase reports: changes are sent from a clock, never from the perform routine ===
+// Phase names as sent to the right outlet, in the order of t_adsr_phase
+const char *const phaseNames[] = {"idle", "startup", "attack", "decay", "sustain", "release", "segment"};
+
+// Helper: sends the phase of a voice, followed by its number (1-based) when there are several
+void send_phase(t_adsr_tilde *x, int i)
+{
+    t_atom voice;
+    SETFLOAT(&voice, i + 1);
+    const t_adsr_phase phase = x->voices[i].phase;
+    x->voiceIo[i].reportedPhase = phase;
+    outlet_anything(x->phaseOut, gensym(phaseNames[static_cast<int>(phase)]), x->voiceCount > 1, &voice);
+}
+
+// Clock callback: reports every voice whose phase differs from the one reported last.
+// Stages begun and left between two reports are not sent.
+void phase_tick(t_adsr_tilde *x)
+{
+    for (int i = 0; i < x->voiceCount; ++i)
+    {
+        if (x->voices[i].phase != x->voiceIo[i].reportedPhase)
+            send_phase(x, i);
+    }
+}
+
+// Helper: schedules a report when a voice entered a phase since the last call
+inline void defer_phase_report(t_adsr_tilde *x)
+{
+    if (!x->phaseNews)
+        return;
+
+    x->phaseNews = false;
+    clock_delay(x->phaseClock, 0);
+}
+
+// Message 'phase': reports the current phase of every voice at once
+void adsr_phase(t_adsr_tilde *x)
+{
+    for (int i = 0; i < x->voiceCount; ++i)
+        send_phase(x, i);
+}
+
+// Message 'stats' prints the figures collected since creation or the last 'stats reset'
+// (builds with PROFILE=1 only)
+void adsr_stats(t_adsr_tilde *x, t_symbol *s)
+{
+#if ADSR_PROFILE
+    t_adsr_stats &st = x->stats;
+    if (s == gensym("reset"))
+    {
+        st = {};
+        return;
+    }
+
+    uint64_t samples = 0;
+    for (uint64_t p : st.phaseSamples)
+        samples += p;
+
+    post("adsr~: %.3f ms in %llu blocks, %.3f ns per voice sample, %llu phase changes", st.performNs * 1e-6,
+         static_cast<unsigned long long>(st.blocks), samples ? static_cast<double>(st.performNs) / samples : 0.0,
+         static_cast<unsigned long long>(st.transitions));
+    for (int i = 0; i < phaseCount; ++i)
+        post("adsr~:   %-8s %llu samples", phaseNames[i], static_cast<unsigned long long>(st.phaseSamples[i]));
+#else
+    (void)s;
+    pd_error(x, "adsr~: stats needs a build with PROFILE=1");
+#endif
+}
+
+// === VCA mode: the envelope multiplies an audio input instead of being output ===
+// Helper: renders one voice with its audio channel handed to the kernels, which write the input
+// times the envelope in the pass that computes it. Through blocks without events an idle voice
+// writes zeros without reading the input and a settled sustain scales the input at once. The
+// output may share the input vector.
+void render_voice_vca(t_adsr_tilde *x, int voice, const t_sample *audio, t_sample *out, int n, int edgeCount, int dueCount, int changeCount)
+{
+    t_adsr_voice *v = &x->voices[voice];
+    int q = 0;
+
+    // a single audio channel feeds all voices, otherwise channel i feeds voice i
+    const t_sample *in = x->audioChannels > 1 ? (voice < x->audioChannels ? audio + voice * n : nullptr) : audio;
+    const bool quiet = !edgeCount && !next_event(x, voice, q, dueCount);
+    const bool settled = v->phase == t_adsr_phase::Sustain && v->currentEnv == x->params->sustainLevel && v->knotSample == 0 && !changeCount;
+
+    if (quiet && (v->phase == t_adsr_phase::Idle || settled))
+    {
+        const t_sample level = v->phase == t_adsr_phase::Idle ? 0 : static_cast<t_sample>(x->params->sustainLevel * x->params->gain * note_of(x, v).level);
+        render_voice(x, v, nullptr, n);
+        if (in && level != 0)
+            std::transform(in, in + n, out, [level](t_sample f) { return f * level; });
+        else
+            std::fill_n(out, n, 0);
+        return;
+    }
+
+    x->vcaIn = in;
+    x->vcaOut = out;
+    render_voice_events(x, voice, out, n, edgeCount, dueCount, changeCount);
+    x->vcaIn = nullptr;
+
+    // a voice without an input channel renders its envelope only to advance it
+    if (!in)
+        std::fill_n(out, n, 0);
+}
+
+// === Gain smoothing: only blocks with a gain change in progress pay for it ===
+// Helper: scales all channels by the gain gliding from 'from' towards gainTarget
+void glide_gain(t_adsr_tilde *x, t_sample *out, int n, double from)
+{
+    const int run = std::min(n, x->gainRemaining);
+    const double step = x->gainStep, target = x->gainTarget;
+
+    for (int c = 0; out && c < x->voiceCount; ++c, out += n)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = static_cast<t_sample>(out[i] * (i < run ? from + step * (i + 1) : target));
+    }
+
+    x->gainRemaining -= run;
+    x->params->gain = x->gainRemaining ? from + step * run : target;
+}
+
+// === Denormals: the 'ftz' message flushes subnormal numbers to zero in the perform routine ===
+// Helper: switches the FPU to flush-to-zero (and denormals-are-zero on x86), returns the old mode
+inline uintptr_t flush_denormals()
+{
+#if defined(__SSE__)
+    const unsigned mode = _mm_getcsr();
+    _mm_setcsr(mode | 0x8040);  // FTZ and DAZ
+    return mode;
+#elif defined(__aarch64__)
+    uintptr_t mode;
+    __asm__ volatile("mrs %0, fpcr" : "=r"(mode));
+    __asm__ volatile("msr fpcr, %0" : : "r"(mode | (1 << 24)));
+    return mode;
+#elif defined(__arm__) && defined(__ARM_FP)
+    uintptr_t mode;
+    __asm__ volatile("vmrs %0, fpscr" : "=r"(mode));
+    __asm__ volatile("vmsr fpscr, %0" : : "r"(mode | (1 << 24)));
+    return mode;
+#else
+    return 0;
+#endif
+}
+
+// Helper: restores the mode flush_denormals returned, so the rest of the DSP chain is unaffected
+inline void restore_denormals(uintptr_t mode)
+{
+#if defined(__SSE__)
+    _mm_setcsr(static_cast<unsigned>(mode));
+#elif defined(__aarch64__)
+    __asm__ volatile("msr fpcr, %0" : : "r"(mode));
+#elif defined(__arm__) && defined(__ARM_FP)
+    __asm__ volatile("vmsr fpscr, %0" : : "r"(mode));
+#else
+    (void)mode;
+#endif
+}
+
+// === Signal processing function ===
+// Renders every voice into its own channel of the output signal. A single gate channel drives
+// all voices, otherwise gate channel i drives voice i. Transitions are collected before a voice
+// writes its output, so the gate and output vectors may share memory.
+t_int *adsr_perform(t_int *w)
+{
+    t_adsr_tilde *x = (t_adsr_tilde *)(w[1]);
+    t_sample *in = (t_sample *)(w[2]);
+    t_sample *out = (t_sample *)(w[3]);
+    int n = (int)(w[4]);
+    const t_sample *audio = (t_sample *)(w[5]);
+    int edgeCount = 0;
+    const uint64_t begin = stats_clock();
+    receive_settings(x);
+    const bool flush = x->params->flushDenormals;
+    const uintptr_t fpuMode = flush ? flush_denormals() : 0;
+    apply_pending_stops(x);
+    int dueCount = due_events(x, n);
+    int changeCount = x->modConnected ? scan_modulation(x, n) : 0;
+
+    // a gliding gain is applied after rendering at unity gain
+    const double gain = x->params->gain;
+    if (x->gainRemaining)
+        x->params->gain = 1.0;
+
+    for (int i = 0; i < x->voiceCount; ++i, out += n)
+    {
+        if (x->gateChannels > 1)
+            edgeCount = (i < x->gateChannels) ? scan_gate(x, in + i * n, n, x->voiceIo[i].gate) : 0;
+        else if (i == 0)
+            edgeCount = scan_gate(x, in, n, x->voiceIo[0].gate);
+
+        if (audio)
+            render_voice_vca(x, i, audio, out, n, edgeCount, dueCount, changeCount);
+        else
+            render_voice_events(x, i, out, n, edgeCount, dueCount, changeCount);
+    }
+
+    if (x->gainRemaining)
+        glide_gain(x, (t_sample *)(w[3]), n, gain);
+
+    // the slots of the messages applied go back to the message thread
+    x->eventHead.store(x->eventHead.load(std::memory_order_relaxed) + dueCount, std::memory_order_release);
+    defer_phase_report(x);
+    if (flush)
+        restore_denormals(fpuMode);
+    stats_perform(x, begin);
+    return (w + 6);
+}
+
+// === Control rate mode: the same state machine advanced by a clock, output as floats ===
+// Helper: advances all voices to the current logical time without rendering samples
+void control_advance(t_adsr_tilde *x)
+{
+    receive_settings(x);
+
+    // the tolerance keeps intervals of whole samples from losing one to rounding
+    double samples = clock_gettimesince(x->controlTime) * x->sampleratems + x->controlFraction;
+    int n = static_cast<int>(samples + 1e-6);
+    x->controlFraction = samples - n;
+    x->controlTime = clock_getlogicaltime();
+    if (n <= 0)
+        return;
+
+    for (int i = 0; i < x->voiceCount; ++i)
+        render_voice(x, &x->voices[i], nullptr, n);
+
+    if (x->gainRemaining)
+        glide_gain(x, nullptr, n, x->params->gain);
+    defer_phase_report(x);
+}
+
+// Helper: envelope value of a voice as it appears at the outlet
+inline t_float control_value(const t_adsr_tilde *x, const t_adsr_voice &v)
+{
+    return v.phase == t_adsr_phase::Idle ? 0 : static_cast<t_float>(v.currentEnv * x->params->gain * note_of(x, &v).level);
+}
+
+// Clock callback: outputs the envelope (one float, or a list with one value per voice) and
+// stops once every voice is idle until the next start
+void control_tick(t_adsr_tilde *x)
+{
+    control_advance(x);
+
+    bool idle = true;
+    for (int i = 0; i < x->voiceCount; ++i)
+    {
+        SETFLOAT(&x->controlList[i], control_value(x, x->voices[i]));
+        idle = idle && x->voices[i].phase == t_adsr_phase::Idle;
+    }
+
+    if (x->voiceCount == 1)
+        outlet_float(x->x_out, atom_getfloat(&x->controlList[0]));
+    else
+        outlet_list(x->x_out, &s_list, x->voiceCount, x->controlList);
+
+    if (!idle)
+        clock_delay(x->controlClock, x->controlInterval);
+}
+
+// Helper: applies a start or stop at the current logical time and keeps the clock running
+void control_event(t_adsr_tilde *x, int first, int last, bool start, const t_adsr_note &note)
+{
+    control_advance(x);
+    apply_event(x, {0.0, 0, first, last, start, note});
+    defer_phase_report(x);
+    clock_delay(x->controlClock, 0);
+}
+
+// Helper: voices addressed by an optional voice number (1-based, like [poly]); all voices without one
+bool voice_range(t_adsr_tilde *x, int argc, t_atom *argv, int &first, int &last)
+{
+    first = 0;
+    last = x->voiceCount;
+
+    if (argc < 1)
+        return true;
+
+    int voice = static_cast<int>(atom_getfloat(argv));
+    if (voice < 1 || voice > x->voiceCount)
+    {
+        pd_error(x, "adsr~: voice %d out of range 1..%d", voice, x->voiceCount);
+        return false;
+    }
+
+    first = voice - 1;
+    last = voice;
+    return true;
+}
+
+// Helper: scaling of a note by velocity (0..127) and key (MIDI note number) with the depths
+// set by the velocity, velattack and keytrack messages
+t_adsr_note note_scaling(const t_adsr_tilde *x, double velocity, double key)
+{
+    const t_adsr_settings &c = x->control;
+    const double v = velocity / 127.0;
+    t_adsr_note note;
+    note.timeScale = static_cast<float>(std::exp2(-c.keyDepth * (key - 60.0) / 12.0));
+    note.attackScale = static_cast<float>((1.0 - c.velAttackDepth * v) * note.timeScale);
+    note.level = static_cast<float>(1.0 + c.velocityDepth * (v - 1.0));
+    return note;
+}
+
+// Helper: queues or applies a start or stop of a range of voices
+void trigger(t_adsr_tilde *x, int first, int last, bool start, const t_adsr_note &note)
+{
+    if (x->controlClock)
+        control_event(x, first, last, start, note);
+    else
+        queue_event(x, first, last, start, note);
+}
+
+void adsr_trigger_start(t_adsr_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    int first, last;
+    if (!voice_range(x, argc, argv, first, last))
+        return;
+
+    trigger(x, first, last, true, neutralNote);
+}
+
+// 'note [<voice>] <velocity> [<key>]' starts a note scaled by velocity and key; the voice number
+// comes first with -voices only. Without velocity the note plays as velocity 127 and key 60,
+// velocity 0 stops the voice.
+void adsr_note(t_adsr_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    int first, last;
+    const int skip = x->voiceCount > 1 && argc > 0;
+    if (!voice_range(x, skip, argv, first, last))
+        return;
+
+    argc -= skip;
+    argv += skip;
+    if (argc < 1)
+    {
+        trigger(x, first, last, true, neutralNote);
+        return;
+    }
+
+    const double velocity = clamp(static_cast<double>(atom_getfloat(argv)), 0.0, 127.0);
+    const double key = argc > 1 ? clamp(static_cast<double>(atom_getfloat(argv + 1)), 0.0, 127.0) : 60.0;
+    if (velocity == 0.0)
+        trigger(x, first, last, false, neutralNote);
+    else
+        trigger(x, first, last, true, note_scaling(x, velocity, key));
+}
+
+void adsr_trigger_stop(t_adsr_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    int first, last;
+    if (!voice_range(x, argc, argv, first, last))
+        return;
+
+    trigger(x, first, last, false, neutralNote);
+}
+
+// === Parameter setters with clamping ===
+void adsr_attack(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.attackTime = stage_time(f); // time in milliseconds
+    publish_settings(x);
+}
+
+void adsr_decay(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.decayTime = stage_time(f); // time in milliseconds
+    publish_settings(x);
+}
+
+void adsr_release(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.releaseTime = f; // time in milliseconds, including the startup fade
+    publish_settings(x);
+}
+
+void adsr_sustain(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.sustainLevel = clamp(static_cast<double>(f), 0.0, 1.0); // level in [0..1]
+    publish_settings(x);
+}
+
+double map_shape_to_exponent(double f)
+{
+    double shape = clamp(f, -1.0, 1.0);
+    return (shape < 0.0) ? 1.0 + shape * 0.9 : 1.0 + shape * 9.0;
+}
+
+// Helper: sets the power exponent, the exponential bend and the curve table of a shape value
+void set_shape(double &shape, double &bend, t_curve_table *&curve, t_floatarg f)
+{
+    shape = map_shape_to_exponent(f);
+    bend = clamp(static_cast<double>(f), -1.0, 1.0) * maxBend;
+    set_curve(curve, shape);
+}
+
+void adsr_attackshape(t_adsr_tilde *x, t_floatarg f)
+{
+    set_shape(x->control.attackShape, x->control.attackBend, x->control.attackCurve, f);
+    publish_settings(x);
+}
+
+void adsr_releaseshape(t_adsr_tilde *x, t_floatarg f)
+{
+    set_shape(x->control.releaseShape, x->control.releaseBend, x->control.releaseCurve, f);
+    publish_settings(x);
+}
+
+// Helper: reads 'set' arguments into a settings block, validated like the single messages
+bool parse_set(t_adsr_tilde *x, t_adsr_settings &c, int argc, t_atom *argv)
+{
+    if (argc < 4 || argc > 7)
+    {
+        pd_error(x, "adsr~: set takes attack, decay, sustain, release and optionally attackshape, releaseshape and g");
+        return false;
+    }
+
+    c.attackTime = stage_time(atom_getfloat(&argv[0]));
+    c.decayTime = stage_time(atom_getfloat(&argv[1]));
+    c.sustainLevel = clamp(static_cast<double>(atom_getfloat(&argv[2])), 0.0, 1.0);
+    c.releaseTime = atom_getfloat(&argv[3]);
+    if (argc > 4)
+        set_shape(c.attackShape, c.attackBend, c.attackCurve, atom_getfloat(&argv[4]));
+    if (argc > 5)
+        set_shape(c.releaseShape, c.releaseBend, c.releaseCurve, atom_getfloat(&argv[5]));
+    if (argc > 6)
+        c.gain = clampmin(static_cast<double>(atom_getfloat(&argv[6])), 0.0);
+    return true;
+}
+
+// 'set <attack> <decay> <sustain> <release> [<attackshape> [<releaseshape> [<g>]]]' sets the
+// whole envelope and hands it to the audio thread at once
+void adsr_set(t_adsr_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (parse_set(x, x->control, argc, argv))
+        publish_settings(x);
+}
+
+// 'velocity <depth>' scales the level of a note by its velocity: 0 (default) leaves it alone,
+// 1 makes it proportional to the velocity
+void adsr_velocity(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.velocityDepth = clamp(static_cast<double>(f), 0.0, 1.0);
+}
+
+// 'velattack <depth>' scales the attack time by the velocity: positive depths shorten the
+// attack of loud notes (1: to zero at velocity 127), negative ones lengthen it (-1: twice as long)
+void adsr_velattack(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.velAttackDepth = clamp(static_cast<double>(f), -1.0, 1.0);
+}
+
+// 'keytrack <depth>' scales all stage times by the key, relative to key 60: depth 1 halves
+// them per octave up, negative depths lengthen them towards higher keys
+void adsr_keytrack(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.keyDepth = clamp(static_cast<double>(f), -1.0, 1.0);
+}
+
+// === Preset banks: complete settings blocks recalled by index ===
+// A bank belongs to one object, or with -bank <name> to all objects with that name. Each object
+// keeps the presets it recalls baked for its sample rate, rebuilt when the rate changes, so a
+// recall hands a ready render state to the audio thread, which only copies it.
+const int maxPresets = 64;
+
+struct t_adsr_bank
+{
+    t_symbol *name;
+    int refs;
+    t_adsr_bank *next;
+    bool stored[maxPresets];
+    unsigned versions[maxPresets];  // counts the stores of each preset
+    t_adsr_settings presets[maxPresets];
+};
+
+// === Preset of the bank baked by one object, current while its version matches the bank's ===
+struct t_adsr_cached
+{
+    t_adsr_baked baked;
+    unsigned version;  // 0 before the first recall
+};
+
+// Banks shared by name, in all Pd instances; like the curve tables, the list and the reference
+// counts are changed under bankLock. Names are symbols of one instance, so a bank is never
+// shared across instances and its presets need no lock.
+static t_adsr_bank *namedBanks;
+static std::mutex bankLock;
+
+// Helper: the bank of the object, created on first use
+t_adsr_bank *bank_of(t_adsr_tilde *x)
+{
+    if (x->bank)
+        return x->bank;
+
+    std::lock_guard<std::mutex> lock(bankLock);
+    t_adsr_bank *b = namedBanks;
+    while (x->bankName && b && b->name != x->bankName)
+        b = b->next;
+
+    if (!x->bankName || !b)
+    {
+        b = (t_adsr_bank *)getbytes(sizeof(t_adsr_bank));
+        b->name = x->bankName;
+        if (b->name)
+        {
+            b->next = namedBanks;
+            namedBanks = b;
+        }
+    }
+
+    ++b->refs;
+    return x->bank = b;
+}
+
+// Helper: gives up the object's bank and frees it with its last user
+void bank_release(t_adsr_tilde *x)
+{
+    t_adsr_bank *b = x->bank;
+    if (!b)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(bankLock);
+        if (--b->refs)
+            return;
+
+        for (t_adsr_bank **link = &namedBanks; *link; link = &(*link)->next)
+        {
+            if (*link == b)
+            {
+                *link = b->next;
+                break;
+            }
+        }
+    }
+    for (t_adsr_settings &p : b->presets)
+        hold_settings(p, {});
+    freebytes(b, sizeof(t_adsr_bank));
+}
+
+// Helper: preset index from the first argument, or -1 with an error
+int preset_index(t_adsr_tilde *x, int argc, t_atom *argv)
+{
+    int i = argc ? static_cast<int>(atom_getfloat(argv)) : -1;
+    if (i < 0 || i >= maxPresets)
+    {
+        pd_error(x, "adsr~: preset %d out of range 0..%d", i, maxPresets - 1);
+        return -1;
+    }
+    return i;
+}
+
+// 'store <index>' keeps the current settings, 'store <index> <set arguments>' the current
+// settings changed by the arguments, which leaves the envelope as it is
+void adsr_store(t_adsr_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    int i = preset_index(x, argc, argv);
+    if (i < 0)
+        return;
+
+    t_adsr_settings s{};
+    hold_settings(s, x->control);
+    if (argc == 1 || parse_set(x, s, argc - 1, argv + 1))
+    {
+        t_adsr_bank *b = bank_of(x);
+        hold_settings(b->presets[i], s);
+        b->stored[i] = true;
+        ++b->versions[i];
+    }
+    hold_settings(s, {});
+}
+
+// Helper: preset i of the bank baked at the object's sample rate, converted again only after a store
+const t_adsr_baked &cached_preset(t_adsr_tilde *x, int i)
+{
+    if (!x->presetCache)
+        x->presetCache = (t_adsr_cached *)getbytes(maxPresets * sizeof(t_adsr_cached));
+
+    t_adsr_cached &c = x->presetCache[i];
+    if (c.version != x->bank->versions[i])
+    {
+        bake_settings(x, x->bank->presets[i], c.baked);
+        c.version = x->bank->versions[i];
+    }
+    return c.baked;
+}
+
+// Helper: bakes the presets recalled so far again for a new sample rate
+void rebake_presets(t_adsr_tilde *x)
+{
+    for (int i = 0; x->presetCache && i < maxPresets; ++i)
+    {
+        t_adsr_cached &c = x->presetCache[i];
+        if (c.version)
+        {
+            bake_settings(x, x->bank->presets[i], c.baked);
+            c.version = x->bank->versions[i];
+        }
+    }
+}
+
+// 'preset <index>' recalls a stored preset
+void adsr_preset(t_adsr_tilde *x, t_floatarg f)
+{
+    t_atom a;
+    SETFLOAT(&a, f);
+    int i = preset_index(x, 1, &a);
+    if (i < 0)
+        return;
+
+    t_adsr_bank *b = bank_of(x);
+    if (!b->stored[i])
+    {
+        pd_error(x, "adsr~: preset %d is empty", i);
+        return;
+    }
+    hold_settings(x->control, b->presets[i]);
+    publish_settings(x, &cached_preset(x, i));
+}
+
+// Curve type of the shaped stages: 0 power curve, 1 exponential (RC) curve
+void adsr_attackcurve(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.attackExp = f != 0.0;
+    publish_settings(x);
+}
+
+void adsr_releasecurve(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.releaseExp = f != 0.0;
+    publish_settings(x);
+}
+
+void adsr_g(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.gain = clampmin(static_cast<double>(f), 0.0);
+    publish_settings(x);
+}
+
+void adsr_oneshot(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.oneShot = f != 0.0;
+    publish_settings(x);
+}
+
+void adsr_exact(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.exactCurves = f != 0.0;
+    publish_settings(x);
+}
+
+void adsr_single(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.singlePrecision = f != 0.0;
+    publish_settings(x);
+}
+
+// 'fixed 1' steps shaped and linear ramps with an integer table position, see ramp_fixed;
+// exponential curves keep their recurrence, 'exact 1' takes precedence
+void adsr_fixed(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.fixedPoint = f != 0.0;
+    publish_settings(x);
+}
+
+void adsr_ftz(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.flushDenormals = f != 0.0;
+    publish_settings(x);
+}
+
+void adsr_startup(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.startupTime = stage_time(f); // time in milliseconds
+    publish_settings(x);
+}
+
+// Breakpoint list: 'points <ms> <level> <shape> ...' replaces attack, decay and release by up
+// to maxPoints ramps; 'points' without arguments returns to the ADSR
+void adsr_points(t_adsr_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (argc % 3)
+        pd_error(x, "adsr~: points takes triplets of time, level and shape");
+    int count = argc / 3;
+    if (count > maxPoints)
+    {
+        pd_error(x, "adsr~: %d points, the last %d are ignored", count, count - maxPoints);
+        count = maxPoints;
+    }
+
+    t_adsr_settings &c = x->control;
+    for (int i = count; i < c.pointCount; ++i)
+        set_curve(c.points[i].curve, 1.0);
+    for (int i = 0; i < count; ++i)
+    {
+        t_adsr_point &p = c.points[i];
+        p.time = stage_time(atom_getfloat(&argv[3 * i]));
+        p.level = clamp(static_cast<double>(atom_getfloat(&argv[3 * i + 1])), 0.0, 1.0);
+        p.shape = map_shape_to_exponent(atom_getfloat(&argv[3 * i + 2]));
+        set_curve(p.curve, p.shape);
+    }
+    c.pointCount = count;
+    publish_settings(x);
+}
+
+// Breakpoint the envelope holds at until stop, counted from 1; 0 holds nowhere
+void adsr_sustainpoint(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.sustainPoint = clamp(static_cast<int>(f), 0, maxPoints);
+    publish_settings(x);
+}
+
+// Retrigger mode: 0 reset (fade to zero first), 1 continue from the current envelope, 2 legato
+void adsr_retrigger(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.retrigger = static_cast<t_adsr_retrigger>(clamp(static_cast<int>(f), 0, 2));
+    publish_settings(x);
+}
+
+void adsr_smooth(t_adsr_tilde *x, t_floatarg f)
+{
+    x->control.smoothTime = clamp(static_cast<double>(f), 0.0, 10000.0); // time in milliseconds
+    publish_settings(x);
+}
+
+// === Setters of the modulation inlets, called by the audio thread on its own parameters ===
+void mod_attack(t_adsr_tilde *x, t_floatarg f)
+{
+    x->attackTime = stage_time(f);
+    x->params->attackPhaseSamples = phase_samples(x, x->attackTime);
+    rescale_notes(x);
+}
+
+void mod_decay(t_adsr_tilde *x, t_floatarg f)
+{
+    x->decayTime = stage_time(f);
+    x->params->decayPhaseSamples = phase_samples(x, x->decayTime);
+    rescale_notes(x);
+}
+
+void mod_release(t_adsr_tilde *x, t_floatarg f)
+{
+    x->releaseTime = f;
+    x->params->releasePhaseSamples = phase_samples(x, release_time(x, f));
+    rescale_notes(x);
+}
+
+void mod_sustain(t_adsr_tilde *x, t_floatarg f)
+{
+    x->params->sustainLevel = clamp(static_cast<double>(f), 0.0, 1.0);
+}
+
+void adsr_dsp(t_adsr_tilde *x, t_signal **sp)
+{
+    set_samplerate(x, sp[0]->s_sr);
+
+    // at control rate the clock drives the envelope, signal inlets are not used
+    if (x->controlClock)
+        return;
+
+    // sp[0] is the gate, channel count and scalar flag only exist in Pd 0.54
+    int n = sp[0]->s_length;
+
+    x->gateChannels = signal_setmultiout ? sp[0]->s_nchans : 1;
+    x->gateScalar = signal_setmultiout && sp[0]->s_isscalar;
+
+    if (x->gateEdgeCapacity < n)
+    {
+        x->gateEdges = (t_adsr_edge *)resizebytes(x->gateEdges, x->gateEdgeCapacity * sizeof(t_adsr_edge), n * sizeof(t_adsr_edge));
+        x->gateEdgeCapacity = n;
+    }
+
+    // with -mod, sp[1..modCount] are the modulation inlets; unconnected ones are scalars and left
+    // to messages, as are all of them before Pd 0.54 (see adsr_new). Only the first channel of a
+    // multichannel signal is read, it modulates all voices.
+    const int modSignals = x->modInlets ? modCount : 0;
+    if (modSignals && x->modCapacity < n)
+    {
+        x->modBuffer = (t_sample *)resizebytes(x->modBuffer, x->modCapacity * modCount * sizeof(t_sample), n * modCount * sizeof(t_sample));
+        x->modChanges = (int *)resizebytes(x->modChanges, x->modCapacity * sizeof(int), n * sizeof(int));
+        x->modCapacity = n;
+    }
+
+    x->modConnected = 0;
+    for (int i = 0; i < modCount; ++i)
+    {
+        t_adsr_mod &m = x->mods[i];
+        m.in = i < modSignals ? sp[1 + i]->s_vec : nullptr;
+        m.copy = i < modSignals ? x->modBuffer + i * n : nullptr;
+        m.connected = i < modSignals && signal_setmultiout && !sp[1 + i]->s_isscalar;
+        m.varying = false;
+        m.last = NAN;
+        x->modConnected += m.connected;
+    }
+
+    // in VCA mode the inlet after them is the audio input
+    t_sample *audio = nullptr;
+    if (x->vca)
+    {
+        audio = sp[1 + modSignals]->s_vec;
+        x->audioChannels = signal_setmultiout ? sp[1 + modSignals]->s_nchans : 1;
+    }
+
+    // one output channel per voice
+    t_signal **out = &sp[1 + modSignals + x->vca];
+    if (signal_setmultiout)
+        signal_setmultiout(out, x->voiceCount);
+
+    dsp_add(adsr_perform, 5, x, sp[0]->s_vec, (*out)->s_vec, n, audio);
+}
+
+// Helper: entries of the message queue for a voice count, a power of two
+inline int event_capacity(int voices)
+{
+    int capacity = eventQueueSize;
+    while (capacity < 2 * voices)
+        capacity *= 2;
+    return capacity;
+}
+
+// Helper: bytes of the block holding the render parameters, the voices and their fixed-point
+// positions, the message queue and the notes and inputs of the voices, with room to align its
+// start to a cache line
+inline size_t dsp_block_bytes(int voices)
+{
+    return paramsBytes + voices * (sizeof(t_adsr_voice) + sizeof(t_ramp_fixed) + sizeof(t_adsr_note) + sizeof(t_adsr_voice_io)) + event_capacity(voices) * sizeof(t_adsr_event) + cacheLine;
+}
+
+// === Object constructor ===
+// Arguments: [1: start attack at current envelope, as 'retrigger 1'] [-voices <n>: polyphonic bank with n channels]
+//            [-control [<ms>]: control rate, outputs floats every <ms> (default: one 64 sample block)]
+//            [-vca: multiplies a signal on the rightmost inlet by the envelope]
+//            [-mod: adds signal inlets modulating attack, decay, sustain and release]
+//            [-bank <name>: shares the presets with all objects using that name]
+void *adsr_new(t_symbol *, int argc, t_atom *argv)
+{
+    t_adsr_tilde *x = (t_adsr_tilde *)pd_new(adsr_tilde_class);
+
+    int voices = 1;
+    bool control = false;
+    double interval = 0.0;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (argv[i].a_type == A_FLOAT)
+            x->control.retrigger = atom_getfloat(&argv[i]) == 1.0 ? t_adsr_retrigger::Continue : t_adsr_retrigger::Reset;
+        else if (atom_getsymbol(&argv[i]) == gensym("-voices") && i + 1 < argc)
+            voices = static_cast<int>(atom_getfloat(&argv[++i]));
+        else if (atom_getsymbol(&argv[i]) == gensym("-bank") && i + 1 < argc)
+            x->bankName = atom_getsymbol(&argv[++i]);
+        else if (atom_getsymbol(&argv[i]) == gensym("-vca"))
+            x->vca = true;
+        else if (atom_getsymbol(&argv[i]) == gensym("-mod"))
+            x->modInlets = true;
+        else if (atom_getsymbol(&argv[i]) == gensym("-control"))
+        {
+            control = true;
+            if (i + 1 < argc && argv[i + 1].a_type == A_FLOAT)
+                interval = atom_getfloat(&argv[++i]);
+        }
+        else
+            pd_error(x, "adsr~: unknown argument '%s'", atom_getsymbol(&argv[i])->s_name);
+    }
+
+    if (x->vca && control)
+    {
+        pd_error(x, "adsr~: -vca has no effect at control rate");
+        x->vca = false;
+    }
+    if (x->modInlets && control)
+    {
+        pd_error(x, "adsr~: -mod has no effect at control rate");
+        x->modInlets = false;
+    }
+    // Before Pd 0.54 an unconnected signal inlet cannot be told from a connected one (s_isscalar),
+    // so the inlets are created for the layout of the patch but never read
+    if (x->modInlets && !signal_setmultiout)
+        pd_error(x, "adsr~: -mod needs Pd 0.54 or later, its inlets are ignored");
+
+    // plain inlet_new rather than signalinlet_new, which older Pd versions do not export
+    for (int i = 0; x->modInlets && i < modCount; ++i)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    if (x->vca)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+
+    x->x_out = outlet_new(&x->x_obj, control ? (voices > 1 ? &s_list : &s_float) : &s_signal);
+    x->phaseOut = outlet_new(&x->x_obj, 0);
+    x->phaseClock = clock_new(x, (t_method)phase_tick);
+
+    if (voices > 1 && !signal_setmultiout && !control)
+    {
+        pd_error(x, "adsr~: -voices needs multichannel signals (Pd 0.54 or later)");
+        voices = 1;
+    }
+
+    x->voiceCount = clamp(voices, 1, maxVoices);
+    x->dspMemory = getbytes(dsp_block_bytes(x->voiceCount));
+    x->params = (t_adsr_params *)((reinterpret_cast<uintptr_t>(x->dspMemory) + cacheLine - 1) & ~static_cast<uintptr_t>(cacheLine - 1));
+    x->voices = (t_adsr_voice *)(reinterpret_cast<char *>(x->params) + paramsBytes);
+    x->fixed = (t_ramp_fixed *)(x->voices + x->voiceCount);
+    std::fill_n(x->fixed, x->voiceCount, t_ramp_fixed{});
+    x->events = (t_adsr_event *)(x->fixed + x->voiceCount);
+    x->eventMask = event_capacity(x->voiceCount) - 1;
+    x->notes = (t_adsr_note *)(x->events + x->eventMask + 1);
+    std::fill_n(x->notes, x->voiceCount, neutralNote);
+    x->voiceIo = (t_adsr_voice_io *)(x->notes + x->voiceCount);
+    x->referenceTime = clock_getlogicaltime();
+    x->control.attackTime = 0.01;
+    x->control.decayTime = 0.1;
+    x->control.sustainLevel = 0.7;
+    x->control.releaseTime = 0.2;
+    x->control.startupTime = defaultStartupTime;
+    x->control.attackShape = 2.0;
+    x->control.attackBend = maxBend / 9.0;  // the shape attackShape 2 is mapped from
+    x->control.releaseShape = 1.0;
+    set_curve(x->control.attackCurve, x->control.attackShape);
+    set_curve(x->control.releaseCurve, x->control.releaseShape);
+    x->control.gain = 1.0;
+    x->control.exactCurves = false;
+    x->control.singlePrecision = false;
+    x->slotFront = 0;
+    x->slotShared.store(1);
+    x->slotBack = 2;
+    hold_settings(x->slots[x->slotFront].settings, x->control);
+
+    // the stage lengths are ready before the first dsp call, at Pd's current sample rate
+    set_samplerate(x, sys_getsr() > 0 ? sys_getsr() : 44100.0);
+
+    x->mods[0].setter = mod_attack;
+    x->mods[1].setter = mod_decay;
+    x->mods[2].setter = mod_sustain;
+    x->mods[3].setter = mod_release;
+
+    for (int i = 0; i < x->voiceCount; ++i)
+    {
+        x->voices[i].currentEnv = 0.0;
+        x->voices[i].renderer = t_adsr_renderer::Idle;
+        x->voices[i].phase = x->voiceIo[i].reportedPhase = t_adsr_phase::Idle;
+    }
+
+    // no dsp call has to happen before a control rate envelope runs
+    if (control)
+    {
+        x->controlInterval = interval > 0.0 ? interval : 64 * x->msPerSample;
+        x->controlTime = clock_getlogicaltime();
+        x->controlList = (t_atom *)getbytes(x->voiceCount * sizeof(t_atom));
+        x->controlClock = clock_new(x, (t_method)control_tick);
+    }
 
     return (void *)x;
 }
 
+// === Object destructor ===
+void adsr_free(t_adsr_tilde *x)
+{
+    clock_free(x->phaseClock);
+    if (x->controlClock)
+    {
+        clock_free(x->controlClock);
+        freebytes(x->controlList, x->voiceCount * sizeof(t_atom));
+    }
+    freebytes(x->dspMemory, dsp_block_bytes(x->voiceCount));
+    freebytes(x->gateEdges, x->gateEdgeCapacity * sizeof(t_adsr_edge));
+    freebytes(x->modBuffer, x->modCapacity * modCount * sizeof(t_sample));
+    freebytes(x->modChanges, x->modCapacity * sizeof(int));
+    bank_release(x);
+    if (x->presetCache)
+        freebytes(x->presetCache, maxPresets * sizeof(t_adsr_cached));
+    for (t_adsr_slot &slot : x->slots)
+        hold_settings(slot.settings, {});
+    hold_settings(x->control, {});
+}
+
 // === Setup function ===
 extern "C"
 {
@@ -290,24 +2594,44 @@ extern "C"
     {
         adsr_tilde_class = class_new(gensym("adsr~"),
                                      (t_newmethod)adsr_new,
-                                     0,
+                                     (t_method)adsr_free,
                                      sizeof(t_adsr_tilde),
-                                     CLASS_DEFAULT,
-                                     A_DEFFLOAT,
+                                     signal_setmultiout ? CLASS_MULTICHANNEL : CLASS_DEFAULT,
+                                     A_GIMME,
                                      0);
 
         class_addmethod(adsr_tilde_class, (t_method)adsr_dsp, gensym("dsp"), A_CANT, 0);
-        CLASS_MAINSIGNALIN(adsr_tilde_class, t_adsr_tilde, currentEnv);
+        CLASS_MAINSIGNALIN(adsr_tilde_class, t_adsr_tilde, x_f);
 
-        class_addmethod(adsr_tilde_class, (t_method)adsr_trigger_start, gensym("start"), A_NULL);
-        class_addmethod(adsr_tilde_class, (t_method)adsr_trigger_stop, gensym("stop"), A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_trigger_start, gensym("start"), A_GIMME, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_trigger_stop, gensym("stop"), A_GIMME, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_note, gensym("note"), A_GIMME, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_attack, gensym("attack"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_decay, gensym("decay"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_sustain, gensym("sustain"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_release, gensym("release"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_set, gensym("set"), A_GIMME, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_store, gensym("store"), A_GIMME, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_preset, gensym("preset"), A_FLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_velocity, gensym("velocity"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_velattack, gensym("velattack"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_keytrack, gensym("keytrack"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_attackshape, gensym("attackshape"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_releaseshape, gensym("releaseshape"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_attackcurve, gensym("attackcurve"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_releasecurve, gensym("releasecurve"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_g, gensym("g"), A_DEFFLOAT, A_NULL);
         class_addmethod(adsr_tilde_class, (t_method)adsr_oneshot, gensym("oneshot"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_exact, gensym("exact"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_single, gensym("single"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_fixed, gensym("fixed"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_ftz, gensym("ftz"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_smooth, gensym("smooth"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_startup, gensym("startup"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_phase, gensym("phase"), A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_stats, gensym("stats"), A_DEFSYM, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_points, gensym("points"), A_GIMME, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_retrigger, gensym("retrigger"), A_DEFFLOAT, A_NULL);
+        class_addmethod(adsr_tilde_class, (t_method)adsr_sustainpoint, gensym("sustainpoint"), A_DEFFLOAT, A_NULL);
     }
 }
@@ -0,0 +1,151 @@
+// bench.cpp — measures the cost of adsr_perform per phase and block size without a running Pd
+//
+// Output is one tab separated line per measurement:
+//   arch  scenario  voices  block  ns_per_sample  voices_per_core
+// ns_per_sample is the time per rendered sample of one voice, voices_per_core the number of
+// voices one core renders in real time at 48 kHz.
+
+#include "pd_stub.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" void adsr_tilde_setup(void);
+
+// === Settings ===
+const t_float sampleRate = 48000;
+const int blockSizes[] = {1, 64, 256, 1024};
+const int voiceCounts[] = {1, 16};
+
+// Samples per voice rendered for one measurement, shorter than the longest (10 s) ramp
+const long benchSamples = 1 << 18;
+
+// Measurements per result, the fastest one is reported
+const int benchRepeats = 3;
+
+// Samples between gate transitions in the retrigger scenario
+const int retriggerPeriod = 32;
+
+#if defined(__AVX__)
+const char *benchArch = "x86_64-avx";
+#elif defined(__x86_64__)
+const char *benchArch = "x86_64";
+#elif defined(__aarch64__)
+const char *benchArch = "aarch64";
+#elif defined(__arm__) && __ARM_ARCH >= 7
+const char *benchArch = "armv7";
+#elif defined(__arm__)
+const char *benchArch = "armv6";
+#else
+const char *benchArch = "unknown";
+#endif
+
+// === Scenarios ===
+// Each scenario brings a fresh object into the phase it measures and keeps it there
+struct t_bench_scenario
+{
+    const char *name;
+    std::vector<std::string> setup;  // messages sent before the object reaches the measured phase
+    long settleSamples;              // samples rendered after setup before timing starts
+    bool gate;                       // drive the gate inlet with a square wave
+    bool vca = false;                // create with -vca and feed a constant to the audio inlet
+};
+
+// Audio inlet of adsr~ -vca without -mod
+const int audioInlet = 1;
+
+const t_bench_scenario scenarios[] = {
+    {"idle", {}, 0, false},
+    {"sustain", {"attack 1", "decay 1", "sustain 0.5", "start"}, 4800, false},
+    {"attack_linear", {"attack 10000", "attackshape 0", "start"}, 480, false},
+    {"attack_shaped", {"attack 10000", "attackshape 0.7", "start"}, 480, false},
+    {"attack_exponential", {"attack 10000", "attackshape 0.7", "attackcurve 1", "start"}, 480, false},
+    {"release_linear", {"attack 1", "decay 1", "release 10000", "releaseshape 0", "start", "stop"}, 4800, false},
+    {"release_shaped", {"attack 1", "decay 1", "release 10000", "releaseshape -0.7", "start", "stop"}, 4800, false},
+    {"attack_linear_single", {"single 1", "attack 10000", "attackshape 0", "start"}, 480, false},
+    {"attack_shaped_single", {"single 1", "attack 10000", "attackshape 0.7", "start"}, 480, false},
+    {"release_linear_single", {"single 1", "attack 1", "decay 1", "release 10000", "releaseshape 0", "start", "stop"}, 4800, false},
+    {"release_shaped_single", {"single 1", "attack 1", "decay 1", "release 10000", "releaseshape -0.7", "start", "stop"}, 4800, false},
+    {"attack_linear_fixed", {"fixed 1", "attack 10000", "attackshape 0", "start"}, 480, false},
+    {"attack_shaped_fixed", {"fixed 1", "attack 10000", "attackshape 0.7", "start"}, 480, false},
+    {"release_shaped_fixed", {"fixed 1", "attack 1", "decay 1", "release 10000", "releaseshape -0.7", "start", "stop"}, 4800, false},
+    {"release_exponential", {"attack 1", "decay 1", "release 10000", "releaseshape -0.7", "releasecurve 1", "start", "stop"}, 4800, false},
+    // a sustain level that makes every output sample of the VCA a subnormal number
+    {"attack_linear_vca", {"attack 10000", "attackshape 0", "start"}, 480, false, true},
+    {"denormal_vca", {"attack 1", "decay 1", "sustain 1e-39", "start"}, 4800, false, true},
+    {"denormal_vca_ftz", {"ftz 1", "attack 1", "decay 1", "sustain 1e-39", "start"}, 4800, false, true},
+    {"retrigger", {"attack 1", "decay 1", "release 1", "attackshape 0.5", "releaseshape 0.5"}, 0, true},
+};
+
+// === Measurement ===
+// Renders the scenario and returns ns per sample and voice. The time includes the stub's
+// share of a DSP tick (clocks and scalar inlets), which dominates at block size 1 as in Pd.
+double measure(const t_bench_scenario &sc, int voices, int n)
+{
+    t_object *x = stub_new("adsr~ -voices " + std::to_string(voices) + (sc.vca ? " -vca" : ""));
+    if (sc.gate)
+        stub_connect(x, 0, 1);
+    if (sc.vca)
+        stub_connect(x, audioInlet, 1);
+    stub_dsp(x, sampleRate, n);
+    if (sc.vca)
+        std::fill_n(stub_inlet(x, audioInlet), n, 0.5f);
+
+    for (const std::string &msg : sc.setup)
+    {
+        stub_send(x, msg);
+        // stop lands after the attack and decay ramps of the scenario
+        if (msg == "start")
+            for (long s = 0; s < sc.settleSamples; s += n)
+                stub_tick(x);
+    }
+
+    long gateSample = 0;
+    auto fill_gate = [&]() {
+        t_sample *in = stub_inlet(x, 0);
+        for (int i = 0; i < n; ++i, ++gateSample)
+            in[i] = (gateSample / retriggerPeriod) & 1;
+    };
+
+    long blocks = std::max(1L, benchSamples / n);
+    auto begin = std::chrono::steady_clock::now();
+    for (long b = 0; b < blocks; ++b)
+    {
+        if (sc.gate)
+            fill_gate();
+        stub_tick(x);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    stub_free(x);
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    return ns / (static_cast<double>(blocks) * n * voices);
+}
+
+int main(int argc, char **argv)
+{
+    adsr_tilde_setup();
+
+    // optional filter: only scenarios whose name contains the argument
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    printf("arch\tscenario\tvoices\tblock\tns_per_sample\tvoices_per_core\n");
+    for (const t_bench_scenario &sc : scenarios)
+    {
+        if (std::string(sc.name).find(filter) == std::string::npos)
+            continue;
+        for (int voices : voiceCounts)
+            for (int n : blockSizes)
+            {
+                double ns = measure(sc, voices, n);
+                for (int r = 1; r < benchRepeats; ++r)
+                    ns = std::min(ns, measure(sc, voices, n));
+                printf("%s\t%s\t%d\t%d\t%.3f\t%.0f\n", benchArch, sc.name, voices, n, ns, 1e9 / (ns * sampleRate));
+                fflush(stdout);
+            }
+    }
+    return 0;
+}
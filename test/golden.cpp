@@ -0,0 +1,618 @@
+// golden.cpp — renders fixed scenarios and compares every envelope engine with stored golden buffers
+//
+// The golden buffers in test/golden are rendered by the reference engine (`exact 1`, the scalar
+// per-sample computation). The reference must reproduce them bit for bit, every other engine must
+// stay within its tolerance. For each engine and scenario the maximum absolute error and the
+// sample-position drift of level crossings are reported. Checks of properties a buffer does not
+// show on its own (where messages take effect, ...) follow, one line each.
+//
+// Usage: adsr~-test [--update] [golden directory]
+//   --update  rewrites the golden buffers from the reference engine
+
+#include "pd_stub.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" void adsr_tilde_setup(void);
+
+// === Scenarios ===
+// A message at a multiple of the block size is sent before the block starting there. Any other
+// one is sent from a clock half a sample after its position, as from [delay] in a patch, so Pd's
+// scheduler delivers it within the block and adsr~ has to place it on that sample.
+struct t_golden_message
+{
+    long at;
+    std::string msg;
+};
+
+// A gate span sets the gate inlet high from sample 'on' up to (excluding) sample 'off'
+struct t_golden_gate
+{
+    long on, off;
+};
+
+// A modulation input of adsr~ -mod ramps from 'from' at the first sample of the scenario to
+// 'to' at its end; it is constant when both are equal
+struct t_golden_mod
+{
+    int inlet;
+    t_sample from, to;
+};
+
+struct t_golden_scenario
+{
+    const char *name;
+    const char *creation;
+    t_float sr;
+    int n;
+    long total;                             // samples per channel rendered
+    int stride;                             // every stride-th sample is stored and compared
+    std::vector<t_golden_message> messages;
+    std::vector<t_golden_gate> gate;        // drives the gate inlet when not empty
+    bool audio = false;                     // feeds a sawtooth to the audio inlet of adsr~ -vca
+    int audioChannels = 1;                  // channels of that input, each with its own phase
+    long dspOn = 0;                         // DSP is off before this sample, the output is 0
+    std::vector<t_golden_mod> mods = {};    // connected modulation inlets of adsr~ -mod
+};
+
+// Audio inlet of adsr~ -vca, right of the gate (no -mod inlets in between)
+const int audioInlet = 1;
+
+// Modulation inlets of adsr~ -mod, right of the gate
+const int attackInlet = 1, decayInlet = 2, sustainInlet = 3, releaseInlet = 4;
+
+// Period; its values are exact in single precision
+const long sawPeriod = 100;
+
+// Phase offset between the channels of a multichannel sawtooth
+const long sawSpread = 37;
+
+// Parameters common to most scenarios: startup 144, attack 960, decay 1440 samples at 48 kHz
+#define GOLDEN_ADSR {0, "attack 20"}, {0, "decay 30"}, {0, "sustain 0.4"}, {0, "release 40"}
+
+// 48 starts and stops while DSP is off, more than the message queue holds, ending with a stop
+// that must not be dropped, and a start and stop after DSP is on
+std::vector<t_golden_message> dsp_off_messages()
+{
+    std::vector<t_golden_message> m = {GOLDEN_ADSR};
+    for (long i = 0; i < 48; ++i)
+        m.push_back({100 + 61 * i, i % 2 ? "stop" : "start"});
+    m.push_back({4321, "start"});
+    m.push_back({5400, "stop"});
+    return m;
+}
+
+const t_golden_scenario scenarios[] = {
+    {"stop_in_startup", "adsr~", 48000, 64, 4800, 1, {GOLDEN_ADSR, {64, "start"}, {2048, "start"}, {2112, "stop"}}, {}},
+    {"stop_in_attack", "adsr~", 48000, 64, 4800, 1, {GOLDEN_ADSR, {64, "start"}, {640, "stop"}}, {}},
+    {"stop_in_decay", "adsr~", 48000, 64, 6400, 1, {GOLDEN_ADSR, {64, "start"}, {1728, "stop"}}, {}},
+    {"stop_in_sustain", "adsr~", 48000, 64, 8000, 1, {GOLDEN_ADSR, {64, "start"}, {4032, "stop"}}, {}},
+    {"start_in_release", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {64, "start"}, {3008, "stop"}, {3840, "start"}, {6400, "stop"}}, {}},
+    {"sustain_change", "adsr~", 48000, 64, 8000, 1, {GOLDEN_ADSR, {64, "start"}, {3200, "sustain 0.7"}, {4800, "stop"}}, {}},
+    {"startup_fade", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "startup 10"}, {64, "start"}, {3200, "start"}, {4800, "startup 0"}, {4800, "start"}, {6400, "stop"}, {6464, "startup 5"}, {6464, "release 20"}, {7680, "start"}}, {}},
+    {"retrigger_modes", "adsr~", 48000, 64, 6400, 1, {GOLDEN_ADSR, {0, "retrigger 2"}, {64, "start"}, {1280, "start"}, {2240, "stop"}, {2560, "start"}, {3200, "retrigger 1"}, {3200, "start"}, {4032, "retrigger 0"}, {4032, "start"}}, {}},
+    {"oneshot", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "oneshot 1"}, {64, "start"}, {640, "stop"}, {4800, "start"}}, {}},
+    {"current_env", "adsr~ 1", 48000, 64, 9600, 1, {GOLDEN_ADSR, {64, "start"}, {768, "start"}, {3008, "stop"}, {3840, "start"}, {6400, "stop"}}, {}},
+    {"shapes_convex", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape 1"}, {0, "releaseshape 1"}, {0, "attack 60"}, {0, "release 70"}, {64, "start"}, {4800, "stop"}}, {}},
+    {"shapes_concave", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape -1"}, {0, "releaseshape -1"}, {0, "attack 60"}, {0, "release 70"}, {64, "start"}, {4800, "stop"}}, {}},
+    {"shapes_exponential", "adsr~", 48000, 64, 12800, 1, {GOLDEN_ADSR, {0, "attackcurve 1"}, {0, "releasecurve 1"}, {0, "attackshape -0.8"}, {0, "releaseshape 0.6"}, {0, "attack 60"}, {0, "release 70"}, {64, "start"}, {4800, "stop"}, {6400, "start"}, {8000, "releaseshape -0.4"}, {8000, "stop"}}, {}},
+    {"shapes_mixed", "adsr~", 44100, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape 0.35"}, {0, "releaseshape -0.6"}, {0, "g 0.8"}, {64, "start"}, {1536, "stop"}, {2048, "start"}, {5120, "stop"}}, {}},
+    {"set_message", "adsr~", 44100, 64, 9600, 1, {{0, "set 20 30 0.4 40 0.35 -0.6 0.8"}, {64, "start"}, {1536, "stop"}, {2048, "start"}, {2560, "set 20 30 0.4 40"}, {5120, "stop"}}, {}},
+    {"presets", "adsr~ -bank golden", 44100, 64, 9600, 1, {{0, "store 0 20 30 0.4 40 0.35 -0.6 0.8"}, {0, "attackcurve 1"}, {0, "store 1 5 10 0.9 60 -0.5 0.5"}, {0, "preset 0"}, {64, "start"}, {1536, "stop"}, {2048, "start"}, {2560, "preset 1"}, {5120, "stop"}, {7040, "preset 0"}, {7040, "start"}}, {}},
+    {"length_change", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape 0.6"}, {0, "releaseshape -0.5"}, {0, "attack 60"}, {64, "start"}, {1280, "attack 30"}, {1408, "attack 80"}, {5120, "stop"}, {6400, "release 20"}}, {}},
+    {"zero_times", "adsr~", 48000, 64, 2560, 1, {{0, "attack 0"}, {0, "decay 0"}, {0, "sustain 0.6"}, {0, "release 0"}, {64, "start"}, {640, "stop"}, {1280, "start"}, {1344, "stop"}}, {}},
+    {"long_times", "adsr~", 48000, 1024, 1536000, 64, {{0, "attack 10000"}, {0, "decay 10000"}, {0, "sustain 0.3"}, {0, "release 10000"}, {0, "attackshape 0.5"}, {0, "releaseshape -0.5"}, {1024, "start"}, {1024000, "stop"}}, {}},
+    {"long_release_steep", "adsr~", 48000, 1024, 482304, 64, {{0, "startup 0"}, {0, "attack 10"}, {0, "decay 0"}, {0, "sustain 1"}, {0, "release 9998.6875"}, {0, "releaseshape -1"}, {1024, "start"}, {2048, "stop"}}, {}},
+    {"block_size_1", "adsr~", 48000, 1, 6400, 1, {GOLDEN_ADSR, {0, "attackshape 0.6"}, {0, "releaseshape 0.8"}, {100, "start"}, {777, "stop"}, {1500, "start"}, {4321, "stop"}}, {}},
+    {"mid_block_64", "adsr~", 48000, 64, 6400, 1, {GOLDEN_ADSR, {100, "start"}, {2987, "stop"}, {4123, "start"}, {4200, "stop"}}, {}},
+    {"mid_block_256", "adsr~ -voices 2", 48000, 256, 7680, 1, {GOLDEN_ADSR, {0, "attackshape 0.6"}, {300, "start 1"}, {301, "start 2"}, {1001, "start 1"}, {3333, "stop 1"}, {4000, "stop"}, {5000, "start 2"}}, {}},
+    {"gate_edges", "adsr~", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape 0.4"}}, {{101, 700}, {1501, 4405}, {4410, 6000}}},
+    {"smoothing", "adsr~ -voices 2", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "smooth 5"}, {64, "start"}, {3200, "sustain 0.8"}, {3264, "g 0.5"}, {3520, "sustain 0.1"}, {4800, "start 2"}, {6400, "g 1"}, {7040, "stop"}}, {}},
+    {"poly", "adsr~ -voices 3", 48000, 64, 6400, 1, {GOLDEN_ADSR, {0, "releaseshape 0.7"}, {64, "start 1"}, {640, "start 2"}, {1280, "start"}, {3200, "stop 3"}, {3840, "phase"}, {4480, "stop"}}, {}},
+    {"breakpoints", "adsr~", 48000, 64, 14400, 1, {{0, "points 5 0 0 20 1 0.5 10 1 0 40 0.5 -0.5 0 0.3 0 30 0 0.4"}, {0, "sustainpoint 4"}, {64, "start"}, {4032, "stop"}, {5440, "start"}, {6400, "stop"}, {8000, "sustainpoint 0"}, {8000, "start"}}, {}},
+    {"velocity_key", "adsr~ -voices 3", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape 0.5"}, {0, "velocity 1"}, {0, "velattack 0.5"}, {0, "keytrack 1"}, {64, "note 1 127 60"}, {64, "note 2 64 72"}, {64, "note 3 32 48"}, {3200, "note 1 40 60"}, {4032, "note 2 0"}, {5440, "stop"}}, {}},
+    {"vca", "adsr~ -vca -voices 2", 48000, 64, 9600, 1, {GOLDEN_ADSR, {0, "attackshape 0.5"}, {0, "g 0.8"}, {64, "start 1"}, {1472, "start 2"}, {6400, "stop"}}, {{101, 4405}}, true},
+    {"vca_mono", "adsr~ -vca", 48000, 64, 6400, 1, {GOLDEN_ADSR, {0, "attackshape 0.5"}, {64, "start"}, {3200, "stop"}}, {}, true},
+    {"vca_multichannel", "adsr~ -vca -voices 3", 48000, 64, 6400, 1, {GOLDEN_ADSR, {0, "releaseshape 0.7"}, {64, "start 1"}, {640, "start 2"}, {3200, "stop 1"}, {4480, "stop"}}, {}, true, 3},
+    {"dsp_off", "adsr~", 48000, 64, 6400, 1, dsp_off_messages(), {}, false, 1, 3200},
+    {"mod_constant", "adsr~ -mod", 48000, 64, 6400, 1, {GOLDEN_ADSR, {64, "start"}, {4000, "stop"}}, {}, false, 1, 0, {{attackInlet, 10, 10}, {sustainInlet, 0.625f, 0.625f}}},
+    {"mod_varying", "adsr~ -mod", 48000, 64, 6400, 1, {GOLDEN_ADSR, {64, "start"}, {4000, "stop"}}, {}, false, 1, 0, {{decayInlet, 40, 10}, {sustainInlet, 0.25f, 0.75f}, {releaseInlet, 20, 60}}},
+};
+
+// === Engines ===
+// Messages selecting an engine, sent to every scenario before its own messages.
+// The first engine is the reference the golden buffers are rendered with.
+struct t_golden_engine
+{
+    const char *name;
+    std::vector<std::string> setup;
+    double tolerance;  // maximum absolute error
+    long maxDrift;     // maximum shift of a level crossing in samples
+};
+
+const t_golden_engine engines[] = {
+    {"exact", {"exact 1"}, 0.0, 0},
+    {"default", {"exact 0"}, 2e-5, 1},
+    {"single", {"exact 0", "single 1"}, 2e-5, 1},
+    {"fixed", {"exact 0", "fixed 1"}, 2e-6, 1},
+};
+
+// Helper: value of a modulation input at sample t of the scenario
+t_sample mod_value(const t_golden_mod &mod, const t_golden_scenario &sc, long t)
+{
+    return mod.from + (mod.to - mod.from) * static_cast<t_sample>(t) / static_cast<t_sample>(sc.total);
+}
+
+// Levels whose crossings are compared to measure the drift
+const double driftLevels[] = {0.05, 0.3, 0.55, 0.85};
+
+// === Rendering ===
+// A message waiting for its clock
+struct t_golden_timed
+{
+    t_object *x;
+    std::string msg;
+    t_clock *clock;
+};
+
+void golden_timed_tick(t_golden_timed *t)
+{
+    stub_send(t->x, t->msg);
+}
+
+// Helper: sends the messages of the scenario due before the block at pos and schedules those
+// inside it, continuing at message m
+void send_messages(t_object *x, const t_golden_scenario &sc, long pos, size_t &m, std::vector<t_golden_timed> &timed)
+{
+    for (; m < sc.messages.size() && sc.messages[m].at < pos + sc.n; ++m)
+    {
+        const t_golden_message &g = sc.messages[m];
+        if (g.at <= pos)
+        {
+            stub_send(x, g.msg);
+            continue;
+        }
+        timed.push_back({x, g.msg, nullptr});
+        timed.back().clock = clock_new(&timed.back(), reinterpret_cast<t_method>(golden_timed_tick));
+        clock_delay(timed.back().clock, (g.at - pos + 0.5) * 1000.0 / sc.sr);
+    }
+}
+
+// Renders the scenario with all output channels of a block stored back to back. With inplace
+// set to a signal inlet the outlet is asked to share its buffer; the render is empty when it
+// does not. With log set, the messages of the first control outlet are appended to it, each
+// prefixed with the number of the block (from 0) before whose DSP tick they were sent.
+std::vector<float> render(const t_golden_scenario &sc, const t_golden_engine &engine, int inplace = -1, std::vector<std::string> *log = nullptr)
+{
+    t_object *x = stub_new(sc.creation);
+    if (!sc.gate.empty())
+        stub_connect(x, 0, 1);
+    if (sc.audio)
+        stub_connect(x, audioInlet, sc.audioChannels);
+    for (const t_golden_mod &mod : sc.mods)
+        stub_connect(x, mod.inlet, 1);
+    stub_dsp(x, sc.sr, sc.n, inplace);
+    if (inplace >= 0 && stub_outlet(x, 0)->s_vec != stub_inlet(x, inplace))
+    {
+        stub_free(x);
+        return {};
+    }
+    for (const std::string &msg : engine.setup)
+        stub_send(x, msg);
+
+    std::vector<float> out;
+    std::vector<t_golden_timed> timed;
+    timed.reserve(sc.messages.size());
+    size_t m = 0;
+    for (long pos = 0; pos < sc.total; pos += sc.n)
+    {
+        send_messages(x, sc, pos, m, timed);
+
+        if (!sc.gate.empty())
+        {
+            t_sample *in = stub_inlet(x, 0);
+            for (int i = 0; i < sc.n; ++i)
+            {
+                long t = pos + i;
+                in[i] = std::any_of(sc.gate.begin(), sc.gate.end(), [t](const t_golden_gate &g) { return t >= g.on && t < g.off; });
+            }
+        }
+
+        if (sc.audio)
+        {
+            t_sample *in = stub_inlet(x, audioInlet);
+            for (int c = 0; c < sc.audioChannels; ++c)
+                for (int i = 0; i < sc.n; ++i)
+                    in[c * sc.n + i] = static_cast<t_sample>((pos + i + c * sawSpread) % sawPeriod - sawPeriod / 2) / (sawPeriod / 2);
+        }
+
+        for (const t_golden_mod &mod : sc.mods)
+        {
+            t_sample *in = stub_inlet(x, mod.inlet);
+            for (int i = 0; i < sc.n; ++i)
+                in[i] = mod_value(mod, sc, pos + i);
+        }
+
+        stub_tick(x, pos >= sc.dspOn);
+        if (log)
+            for (const std::string &line : stub_messages(x, 0))
+                log->push_back(std::to_string(pos / sc.n) + " " + line);
+
+        t_signal *s = stub_outlet(x, 0);
+        for (int c = 0; c < s->s_nchans; ++c)
+            for (int i = 0; i < sc.n; ++i)
+                if ((pos + i) % sc.stride == 0)
+                    out.push_back(pos >= sc.dspOn ? s->s_vec[c * sc.n + i] : 0.0f);
+    }
+
+    for (t_golden_timed &t : timed)
+        clock_free(t.clock);
+    stub_free(x);
+    return out;
+}
+
+// === Golden files: raw 32 bit floats in host byte order ===
+std::string golden_path(const std::string &dir, const t_golden_scenario &sc)
+{
+    return dir + "/" + sc.name + ".f32";
+}
+
+bool read_golden(const std::string &path, std::vector<float> &data)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    float v;
+    while (fread(&v, sizeof(v), 1, f) == 1)
+        data.push_back(v);
+    fclose(f);
+    return true;
+}
+
+bool write_golden(const std::string &path, const std::vector<float> &data)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data.data(), sizeof(float), data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+// === Comparison ===
+// Sample positions where the signal rises or falls through the level
+std::vector<long> crossings(const std::vector<float> &s, double level)
+{
+    std::vector<long> at;
+    for (size_t i = 1; i < s.size(); ++i)
+        if ((s[i - 1] < level) != (s[i] < level))
+            at.push_back(static_cast<long>(i));
+    return at;
+}
+
+// Largest shift between matching crossings, -1 when the crossings do not pair up
+long drift(const std::vector<float> &ref, const std::vector<float> &got, int stride)
+{
+    long worst = 0;
+    for (double level : driftLevels)
+    {
+        std::vector<long> a = crossings(ref, level), b = crossings(got, level);
+        if (a.size() != b.size())
+            return -1;
+        for (size_t i = 0; i < a.size(); ++i)
+            worst = std::max(worst, std::labs(a[i] - b[i]) * stride);
+    }
+    return worst;
+}
+
+double max_error(const std::vector<float> &ref, const std::vector<float> &got)
+{
+    double worst = 0.0;
+    for (size_t i = 0; i < ref.size(); ++i)
+    {
+        double e = std::fabs(static_cast<double>(ref[i]) - got[i]);
+        if (!(e <= worst))
+            worst = e;  // a NaN on either side counts as the largest error
+    }
+    return worst;
+}
+
+// === Checks ===
+// Properties the comparison with a golden buffer does not show, asserted on the reference
+// engine. Each check prints one line in the format of the comparison and returns false when it
+// fails.
+const t_golden_scenario &scenario(const char *name)
+{
+    return *std::find_if(std::begin(scenarios), std::end(scenarios), [name](const t_golden_scenario &sc) { return !strcmp(sc.name, name); });
+}
+
+// Helper: sample i of channel c in a render with stride 1
+float sample_of(const std::vector<float> &out, const t_golden_scenario &sc, int c, long i)
+{
+    const long channels = static_cast<long>(out.size()) / sc.total;
+    return out[(i / sc.n) * channels * sc.n + c * sc.n + i % sc.n];
+}
+
+bool report(const char *check, const char *name, bool ok, const std::string &detail)
+{
+    printf("check\t%s %s\t-\t-\t%s\n", check, name, ok ? "ok" : ("FAIL " + detail).c_str());
+    return ok;
+}
+
+// A message at sample 'at' of channel c takes effect on that sample: every stage renders its
+// first sample at the level it starts from, so the envelope holds through 'at' and moves on
+// at + 1. A message placed a sample early or late breaks one of the two.
+struct t_golden_onset
+{
+    const char *scenario;
+    int channel;
+    std::vector<long> at;
+};
+
+const t_golden_onset onsets[] = {
+    {"mid_block_64", 0, {100, 2987, 4123, 4200}},
+    {"mid_block_256", 0, {300, 1001, 3333}},
+    {"mid_block_256", 1, {301, 4000, 5000}},
+};
+
+bool check_onsets()
+{
+    bool passed = true;
+    for (const t_golden_onset &o : onsets)
+    {
+        const t_golden_scenario &sc = scenario(o.scenario);
+        std::vector<float> out = render(sc, engines[0]);
+        std::string detail;
+        for (long at : o.at)
+        {
+            float before = sample_of(out, sc, o.channel, at - 1), on = sample_of(out, sc, o.channel, at), after = sample_of(out, sc, o.channel, at + 1);
+            if (on != before || after == on)
+                detail += " " + std::to_string(at);
+        }
+        std::string name = std::string(o.scenario) + " channel " + std::to_string(o.channel + 1);
+        passed &= report("onsets", name.c_str(), detail.empty(), "at" + detail);
+    }
+    return passed;
+}
+
+// adsr~ -vca renders the same samples when Pd gives its output the buffer of the audio input,
+// with one channel and with one channel per voice
+const char *const inplaceScenarios[] = {"vca_mono", "vca_multichannel"};
+
+bool check_inplace()
+{
+    bool passed = true;
+    for (const char *name : inplaceScenarios)
+    {
+        const t_golden_scenario &sc = scenario(name);
+        std::vector<float> ref = render(sc, engines[0]), got = render(sc, engines[0], audioInlet);
+        bool ok = got.size() == ref.size() && !memcmp(ref.data(), got.data(), ref.size() * sizeof(float));
+        passed &= report("inplace", name, ok, got.empty() ? "buffers not shared" : "samples differ");
+    }
+    return passed;
+}
+
+// adsr~ -mod: a connected sustain input overrides the sustain message. While the voice sustains,
+// the output equals the input on every sample, whether it is constant or changes every sample.
+struct t_golden_sustain
+{
+    const char *scenario;
+    long from, to;  // samples the voice sustains at
+};
+
+const t_golden_sustain modSustains[] = {
+    {"mod_constant", 2500, 4000},
+    {"mod_varying", 2500, 4000},
+};
+
+bool check_modulation()
+{
+    bool passed = true;
+    for (const t_golden_sustain &m : modSustains)
+    {
+        const t_golden_scenario &sc = scenario(m.scenario);
+        const t_golden_mod &mod = *std::find_if(sc.mods.begin(), sc.mods.end(), [](const t_golden_mod &g) { return g.inlet == sustainInlet; });
+        std::vector<float> out = render(sc, engines[0]);
+        long t = m.from;
+        while (t < m.to && sample_of(out, sc, 0, t) == mod_value(mod, sc, t))
+            ++t;
+        passed &= report("modulation", m.scenario, t == m.to, "at " + std::to_string(t));
+    }
+    return passed;
+}
+
+// The phase outlet reports each change from a clock after the block it happened in, so it
+// arrives before the next block, in the order of the voices, with the voice number only with
+// -voices. Stages passed within one sample are not reported, 'phase' answers at once.
+struct t_golden_phases
+{
+    const char *scenario;
+    std::vector<std::string> log;  // block before which a message is sent, the message
+};
+
+const t_golden_phases phaseLogs[] = {
+    {"stop_in_sustain", {"2 attack", "16 decay", "39 sustain", "64 release", "91 idle"}},
+    {"mid_block_64", {"2 attack", "17 decay", "40 sustain", "47 release", "65 startup", "66 release", "94 idle"}},
+    {"zero_times", {"2 sustain", "11 idle", "21 sustain", "22 idle"}},
+    {"poly", {"2 attack 1", "11 attack 2", "16 decay 1", "21 startup 1", "21 startup 2", "21 attack 3", "23 attack 1", "23 attack 2", "35 decay 3", "38 decay 1", "38 decay 2", "51 release 3", "60 sustain 1", "60 sustain 2", "60 release 3",
+              "71 release 1", "71 release 2", "75 idle 3", "95 idle 1", "95 idle 2"}},
+};
+
+bool check_phases()
+{
+    bool passed = true;
+    for (const t_golden_phases &p : phaseLogs)
+    {
+        std::vector<std::string> log;
+        render(scenario(p.scenario), engines[0], -1, &log);
+        size_t k = 0;
+        while (k < log.size() && k < p.log.size() && log[k] == p.log[k])
+            ++k;
+        bool ok = k == log.size() && k == p.log.size();
+        passed &= report("phases", p.scenario, ok, "at message " + std::to_string(k + 1) + ": " + (k < log.size() ? log[k] : "none"));
+    }
+    return passed;
+}
+
+// adsr~ -control advances the envelope of the signal object without rendering it: at the
+// logical time of sample T it outputs signal sample T - 1 of every voice, or sample T when a
+// stage ended with sample T - 1, at each start or stop and every interval after it. Its clock
+// stops with an output of 0 once all voices are idle; the object is rendered for twice the
+// scenario, so a clock that kept running would show. Voices still sounding at the end of the
+// scenario keep it running, and outputs after the end are only checked for their timing.
+const char *const controlScenarios[] = {"mid_block_64", "mid_block_256"};
+
+// Interval of the control scenarios, 96 samples at 48 kHz
+const double controlInterval = 2.0;
+
+struct t_golden_output
+{
+    long at;  // sample of the logical time the output was sent at
+    std::vector<float> values;
+};
+
+std::vector<t_golden_output> render_control(const t_golden_scenario &sc)
+{
+    const double created = stub_time();
+    t_object *x = stub_new(std::string(sc.creation) + " -control " + std::to_string(controlInterval));
+    stub_dsp(x, sc.sr, sc.n);
+    for (const std::string &msg : engines[0].setup)
+        stub_send(x, msg);
+
+    std::vector<t_golden_output> out;
+    std::vector<t_golden_timed> timed;
+    timed.reserve(sc.messages.size());
+    size_t m = 0;
+    for (long pos = 0; pos < 2 * sc.total; pos += sc.n)
+    {
+        send_messages(x, sc, pos, m, timed);
+        stub_tick(x);
+        for (const auto &msg : stub_timed_messages(x, 0))
+        {
+            // messages come at whole samples or half a sample after them
+            t_golden_output o = {static_cast<long>(std::floor((msg.first - created) * sc.sr / 1000.0 + 0.25)), {}};
+            std::istringstream line(msg.second);
+            std::string selector;
+            line >> selector;
+            for (float v; line >> v;)
+                o.values.push_back(v);
+            out.push_back(o);
+        }
+    }
+
+    for (t_golden_timed &t : timed)
+        clock_free(t.clock);
+    stub_free(x);
+    return out;
+}
+
+bool check_control()
+{
+    bool passed = true;
+    for (const char *name : controlScenarios)
+    {
+        const t_golden_scenario &sc = scenario(name);
+        const long interval = std::lround(controlInterval * sc.sr / 1000.0);
+        std::vector<float> ref = render(sc, engines[0]);
+        std::vector<t_golden_output> got = render_control(sc);
+        const int channels = static_cast<int>(ref.size() / sc.total);
+
+        std::string detail = got.empty() ? "no output" : "";
+        long last = -1;
+        for (const t_golden_output &o : got)
+        {
+            const bool event = std::any_of(sc.messages.begin(), sc.messages.end(), [&o](const t_golden_message &g) {
+                return g.at == o.at && (!g.msg.compare(0, 5, "start") || !g.msg.compare(0, 4, "stop"));
+            });
+            bool ok = o.at >= 1 && (event || o.at == last + interval) && static_cast<int>(o.values.size()) == channels;
+            for (int c = 0; ok && c < channels && o.at < sc.total; ++c)
+                ok = o.values[c] == sample_of(ref, sc, c, o.at - 1) || o.values[c] == sample_of(ref, sc, c, o.at);
+            if (!ok)
+            {
+                detail = "output at " + std::to_string(o.at) + " after " + std::to_string(last);
+                break;
+            }
+            last = o.at;
+        }
+
+        bool sounding = false;
+        for (int c = 0; c < channels; ++c)
+            sounding = sounding || sample_of(ref, sc, c, sc.total - 1) != 0.0f;
+        if (detail.empty() && sounding != (got.back().at >= 2 * sc.total - sc.n))
+            detail = sounding ? "clock stopped at " + std::to_string(got.back().at) : "clock still running at " + std::to_string(got.back().at);
+        if (detail.empty() && !sounding && std::any_of(got.back().values.begin(), got.back().values.end(), [](float v) { return v != 0.0f; }))
+            detail = "last output not 0";
+        passed &= report("control", name, detail.empty(), detail);
+    }
+    return passed;
+}
+
+int main(int argc, char **argv)
+{
+    adsr_tilde_setup();
+
+    bool update = false;
+    std::string dir = "test/golden";
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--update"))
+            update = true;
+        else
+            dir = argv[i];
+    }
+
+    if (update)
+    {
+        for (const t_golden_scenario &sc : scenarios)
+        {
+            if (!write_golden(golden_path(dir, sc), render(sc, engines[0])))
+            {
+                fprintf(stderr, "cannot write %s\n", golden_path(dir, sc).c_str());
+                return 1;
+            }
+            printf("wrote %s\n", golden_path(dir, sc).c_str());
+        }
+        return 0;
+    }
+
+    int failures = 0;
+    printf("engine\tscenario\tmax_abs_error\tdrift\tresult\n");
+    for (const t_golden_engine &engine : engines)
+        for (const t_golden_scenario &sc : scenarios)
+        {
+            std::vector<float> ref, got = render(sc, engine);
+            if (!read_golden(golden_path(dir, sc), ref))
+            {
+                printf("%s\t%s\t-\t-\tmissing %s\n", engine.name, sc.name, golden_path(dir, sc).c_str());
+                ++failures;
+                continue;
+            }
+            if (ref.size() != got.size())
+            {
+                printf("%s\t%s\t-\t-\tlength %zu, expected %zu\n", engine.name, sc.name, got.size(), ref.size());
+                ++failures;
+                continue;
+            }
+
+            // a zero tolerance asks for identical bits, which also tells -0 from 0
+            double error = max_error(ref, got);
+            long shift = drift(ref, got, sc.stride);
+            bool same = engine.tolerance == 0.0 ? !memcmp(ref.data(), got.data(), ref.size() * sizeof(float)) : error <= engine.tolerance;
+            bool ok = same && shift >= 0 && shift <= engine.maxDrift;
+            failures += !ok;
+            printf("%s\t%s\t%g\t%ld\t%s\n", engine.name, sc.name, error, shift, ok ? "ok" : "FAIL");
+        }
+
+    failures += !check_onsets();
+    failures += !check_inplace();
+    failures += !check_modulation();
+    failures += !check_phases();
+    failures += !check_control();
+
+    printf("%d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,799 @@
+// pd_stub.cpp — minimal stand-in for the Pure Data runtime, used to drive externals from test and bench programs
+#pragma GCC diagnostic ignored "-Wcast-function-type"
+
+#include "pd_stub.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+
+// === Runtime structures the real Pd keeps private ===
+struct t_stub_method
+{
+    t_symbol *sel;
+    t_method fn;
+    std::vector<t_atomtype> args;
+};
+
+struct _class
+{
+    t_symbol *name;
+    t_newmethod newmethod;
+    t_method freemethod;
+    size_t size;
+    int flags;
+    std::vector<t_atomtype> newargs;
+    std::vector<t_stub_method> methods;
+    t_method bangmethod, floatmethod, listmethod, anymethod;
+    int signalinOffset;
+};
+
+struct _outlet
+{
+    t_object *owner;
+    t_symbol *type;
+    std::vector<std::string> log;
+    std::vector<double> times;  // logical time of each logged message
+};
+
+struct _inlet
+{
+    t_object *owner;
+    t_pd *dest;
+    t_symbol *from, *to;
+    t_float *floatptr;
+    bool signal;
+    t_float scalar;
+};
+
+struct _clock
+{
+    void *owner;
+    t_method fn;
+    double settime;
+    bool set;
+};
+
+// Per-object bookkeeping of the stub
+struct t_stub_object
+{
+    std::vector<std::unique_ptr<_inlet>> inlets;
+    std::vector<std::unique_ptr<_outlet>> outlets;
+    std::map<int, int> connected;
+    std::vector<std::unique_ptr<t_signal>> signals;
+    std::vector<std::vector<t_sample>> buffers;
+    std::vector<t_signal *> sigs;
+    std::vector<std::vector<t_int>> chain;
+    std::vector<int> inletSignals;
+    int inplace = -1;  // inlet whose buffer the first signal outlet reuses, see stub_dsp
+    int n = 64;
+    t_float sr = 44100;
+};
+
+t_symbol s_pointer, s_float, s_symbol, s_bang, s_list, s_anything, s_signal, s__N, s__X, s_x, s_y, s_;
+
+static std::map<std::string, std::unique_ptr<t_symbol>> &symbols()
+{
+    static std::map<std::string, std::unique_ptr<t_symbol>> table;
+    return table;
+}
+
+static std::map<std::string, t_class *> &classes()
+{
+    static std::map<std::string, t_class *> table;
+    return table;
+}
+
+static std::map<const t_object *, t_stub_object> objects;
+static std::vector<t_clock *> clocks;
+static t_object *constructing = nullptr;
+static t_stub_object *building = nullptr;
+static double logicalTime = 0.0;
+static t_float currentSr = 44100;
+static int currentN = 64;
+
+static t_stub_object &stub_of(const t_object *x)
+{
+    return objects[x];
+}
+
+// === Symbols ===
+t_symbol *gensym(const char *s)
+{
+    static bool init = false;
+    if (!init)
+    {
+        init = true;
+        const std::pair<t_symbol *, const char *> builtin[] = {
+            {&s_pointer, "pointer"}, {&s_float, "float"}, {&s_symbol, "symbol"}, {&s_bang, "bang"}, {&s_list, "list"}, {&s_anything, "anything"}, {&s_signal, "signal"}, {&s__N, "#N"}, {&s__X, "#X"}, {&s_x, "x"}, {&s_y, "y"}, {&s_, ""}};
+        for (auto &b : builtin)
+        {
+            b.first->s_name = b.second;
+            symbols()[b.second].reset(new t_symbol(*b.first));
+        }
+    }
+    if (!strcmp(s, "float"))
+        return &s_float;
+    if (!strcmp(s, "signal"))
+        return &s_signal;
+    if (!strcmp(s, "list"))
+        return &s_list;
+    if (!strcmp(s, "bang"))
+        return &s_bang;
+    if (!strcmp(s, "symbol"))
+        return &s_symbol;
+    auto &slot = symbols()[s];
+    if (!slot)
+    {
+        slot.reset(new t_symbol());
+        slot->s_name = strdup(s);
+    }
+    return slot.get();
+}
+
+// === Atoms ===
+t_float atom_getfloat(const t_atom *a)
+{
+    return a->a_type == A_FLOAT ? a->a_w.w_float : 0;
+}
+
+t_int atom_getint(const t_atom *a)
+{
+    return static_cast<t_int>(atom_getfloat(a));
+}
+
+t_symbol *atom_getsymbol(const t_atom *a)
+{
+    return a->a_type == A_SYMBOL ? a->a_w.w_symbol : &s_float;
+}
+
+t_float atom_getfloatarg(int which, int argc, const t_atom *argv)
+{
+    return which < argc ? atom_getfloat(&argv[which]) : 0;
+}
+
+t_symbol *atom_getsymbolarg(int which, int argc, const t_atom *argv)
+{
+    return which < argc ? atom_getsymbol(&argv[which]) : &s_;
+}
+
+// === Memory ===
+void *getbytes(size_t nbytes)
+{
+    return calloc(1, nbytes ? nbytes : 1);
+}
+
+void *getzbytes(size_t nbytes)
+{
+    return getbytes(nbytes);
+}
+
+void *copybytes(const void *src, size_t nbytes)
+{
+    void *p = getbytes(nbytes);
+    memcpy(p, src, nbytes);
+    return p;
+}
+
+void freebytes(void *x, size_t)
+{
+    free(x);
+}
+
+void *resizebytes(void *x, size_t oldsize, size_t newsize)
+{
+    void *p = realloc(x, newsize ? newsize : 1);
+    if (newsize > oldsize)
+        memset((char *)p + oldsize, 0, newsize - oldsize);
+    return p;
+}
+
+// === Printing ===
+void post(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+void startpost(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void poststring(const char *s)
+{
+    printf(" %s", s);
+}
+
+void postfloat(t_floatarg f)
+{
+    printf(" %g", f);
+}
+
+void endpost(void)
+{
+    printf("\n");
+}
+
+void pd_error(const void *, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "error: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+}
+
+void logpost(const void *, int, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+// === Classes ===
+t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod, size_t size, int flags, t_atomtype arg1, ...)
+{
+    t_class *c = new _class();
+    c->name = name;
+    c->newmethod = newmethod;
+    c->freemethod = freemethod;
+    c->size = size;
+    c->flags = flags;
+    c->bangmethod = c->floatmethod = c->listmethod = c->anymethod = nullptr;
+    c->signalinOffset = -1;
+
+    va_list ap;
+    va_start(ap, arg1);
+    for (int t = arg1; t != A_NULL; t = va_arg(ap, int))
+        c->newargs.push_back(static_cast<t_atomtype>(t));
+    va_end(ap);
+
+    classes()[name->s_name] = c;
+    return c;
+}
+
+void class_addcreator(t_newmethod, t_symbol *, t_atomtype, ...)
+{
+}
+
+void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...)
+{
+    t_stub_method m{sel, fn, {}};
+    va_list ap;
+    va_start(ap, arg1);
+    for (int t = arg1; t != A_NULL; t = va_arg(ap, int))
+        m.args.push_back(static_cast<t_atomtype>(t));
+    va_end(ap);
+    c->methods.push_back(m);
+}
+
+void(class_addbang)(t_class *c, t_method fn)
+{
+    c->bangmethod = fn;
+}
+
+void class_doaddfloat(t_class *c, t_method fn)
+{
+    c->floatmethod = fn;
+}
+
+void(class_addlist)(t_class *c, t_method fn)
+{
+    c->listmethod = fn;
+}
+
+void(class_addanything)(t_class *c, t_method fn)
+{
+    c->anymethod = fn;
+}
+
+void class_domainsignalin(t_class *c, int onset)
+{
+    c->signalinOffset = onset;
+}
+
+void class_sethelpsymbol(t_class *, t_symbol *)
+{
+}
+
+// === Objects, inlets and outlets ===
+t_pd *pd_new(t_class *c)
+{
+    t_object *x = (t_object *)getbytes(c->size);
+    x->ob_pd = c;
+    constructing = x;
+    objects[x];
+    return &x->ob_pd;
+}
+
+void pd_free(t_pd *x)
+{
+    objects.erase((t_object *)x);
+    freebytes(x, 0);
+}
+
+t_outlet *outlet_new(t_object *owner, t_symbol *s)
+{
+    auto &o = stub_of(owner);
+    o.outlets.emplace_back(new _outlet{owner, s, {}, {}});
+    return o.outlets.back().get();
+}
+
+static void log_message(t_outlet *x, t_symbol *s, int argc, const t_atom *argv)
+{
+    std::ostringstream line;
+    line.precision(9);  // enough to read a float back unchanged
+    line << s->s_name;
+    for (int i = 0; i < argc; i++)
+    {
+        if (argv[i].a_type == A_FLOAT)
+            line << " " << argv[i].a_w.w_float;
+        else if (argv[i].a_type == A_SYMBOL)
+            line << " " << argv[i].a_w.w_symbol->s_name;
+    }
+    x->log.push_back(line.str());
+    x->times.push_back(logicalTime);
+}
+
+void outlet_bang(t_outlet *x)
+{
+    log_message(x, &s_bang, 0, nullptr);
+}
+
+void outlet_float(t_outlet *x, t_float f)
+{
+    t_atom a;
+    SETFLOAT(&a, f);
+    log_message(x, &s_float, 1, &a);
+}
+
+void outlet_symbol(t_outlet *x, t_symbol *s)
+{
+    t_atom a;
+    SETSYMBOL(&a, s);
+    log_message(x, &s_symbol, 1, &a);
+}
+
+void outlet_list(t_outlet *x, t_symbol *, int argc, t_atom *argv)
+{
+    log_message(x, &s_list, argc, argv);
+}
+
+void outlet_anything(t_outlet *x, t_symbol *s, int argc, t_atom *argv)
+{
+    log_message(x, s, argc, argv);
+}
+
+void outlet_free(t_outlet *)
+{
+}
+
+t_inlet *inlet_new(t_object *owner, t_pd *dest, t_symbol *s1, t_symbol *s2)
+{
+    auto &o = stub_of(owner);
+    o.inlets.emplace_back(new _inlet{owner, dest, s1, s2, nullptr, s1 == &s_signal, 0});
+    return o.inlets.back().get();
+}
+
+t_inlet *floatinlet_new(t_object *owner, t_float *fp)
+{
+    auto &o = stub_of(owner);
+    o.inlets.emplace_back(new _inlet{owner, &owner->ob_pd, &s_float, &s_float, fp, false, 0});
+    return o.inlets.back().get();
+}
+
+t_inlet *signalinlet_new(t_object *owner, t_float f)
+{
+    auto &o = stub_of(owner);
+    o.inlets.emplace_back(new _inlet{owner, &owner->ob_pd, &s_signal, &s_signal, nullptr, true, f});
+    return o.inlets.back().get();
+}
+
+void inlet_free(t_inlet *)
+{
+}
+
+// === Clocks and logical time ===
+t_clock *clock_new(void *owner, t_method fn)
+{
+    t_clock *c = new _clock{owner, fn, 0.0, false};
+    clocks.push_back(c);
+    return c;
+}
+
+void clock_set(t_clock *x, double systime)
+{
+    x->settime = systime;
+    x->set = true;
+}
+
+void clock_delay(t_clock *x, double delaytime)
+{
+    clock_set(x, logicalTime + (delaytime > 0 ? delaytime : 0));
+}
+
+void clock_unset(t_clock *x)
+{
+    x->set = false;
+}
+
+void clock_free(t_clock *x)
+{
+    for (auto it = clocks.begin(); it != clocks.end(); ++it)
+        if (*it == x)
+        {
+            clocks.erase(it);
+            break;
+        }
+    delete x;
+}
+
+double clock_getlogicaltime(void)
+{
+    return logicalTime;
+}
+
+double clock_getsystime(void)
+{
+    return logicalTime;
+}
+
+double clock_gettimesince(double prevsystime)
+{
+    return logicalTime - prevsystime;
+}
+
+double clock_getsystimeafter(double delaytime)
+{
+    return logicalTime + delaytime;
+}
+
+t_float sys_getsr(void)
+{
+    return currentSr;
+}
+
+int sys_getblksize(void)
+{
+    return currentN;
+}
+
+// === DSP ===
+void dsp_add(t_perfroutine f, int n, ...)
+{
+    std::vector<t_int> w(n + 1);
+    w[0] = (t_int)f;
+    va_list ap;
+    va_start(ap, n);
+    for (int i = 1; i <= n; i++)
+        w[i] = va_arg(ap, t_int);
+    va_end(ap);
+    building->chain.push_back(w);
+}
+
+void dsp_addv(t_perfroutine f, int n, t_int *vec)
+{
+    std::vector<t_int> w(n + 1);
+    w[0] = (t_int)f;
+    for (int i = 0; i < n; i++)
+        w[i + 1] = vec[i];
+    building->chain.push_back(w);
+}
+
+static t_signal *stub_signal(t_stub_object &o, int n, int nchans, t_float sr)
+{
+    o.buffers.emplace_back(static_cast<size_t>(n) * nchans, 0);
+    o.signals.emplace_back(new t_signal());
+    t_signal *sig = o.signals.back().get();
+    sig->s_n = n;
+    sig->s_vec = o.buffers.back().data();
+    sig->s_sr = sr;
+    sig->s_nchans = nchans;
+    sig->s_overlap = 1;
+    return sig;
+}
+
+// Helper: signal of the connected inlet the first outlet may reuse, as Pd's scheduler hands a
+// freed input buffer of the same size to an output; null when there is none
+static t_signal *reusable_input(t_stub_object &o, int nchans)
+{
+    for (size_t i = 0; i < o.inletSignals.size(); i++)
+        if (o.inletSignals[i] == o.inplace && !o.sigs[i]->s_isscalar && o.sigs[i]->s_nchans == nchans)
+            return o.sigs[i];
+    return nullptr;
+}
+
+void signal_setmultiout(t_signal **sig, int nchans)
+{
+    t_signal *reused = sig == &building->sigs[building->inletSignals.size()] ? reusable_input(*building, nchans) : nullptr;
+    *sig = reused ? reused : stub_signal(*building, building->n, nchans, building->sr);
+}
+
+// === Driver API ===
+static std::vector<std::string> tokenize(const std::string &line)
+{
+    std::istringstream in(line);
+    std::vector<std::string> tokens;
+    for (std::string t; in >> t;)
+        tokens.push_back(t);
+    return tokens;
+}
+
+static bool is_number(const std::string &s, t_float &f)
+{
+    char *end = nullptr;
+    f = strtof(s.c_str(), &end);
+    return !s.empty() && *end == 0;
+}
+
+static std::vector<t_atom> to_atoms(const std::vector<std::string> &tokens, size_t from)
+{
+    std::vector<t_atom> atoms;
+    for (size_t i = from; i < tokens.size(); i++)
+    {
+        t_atom a;
+        t_float f;
+        if (is_number(tokens[i], f))
+            SETFLOAT(&a, f);
+        else
+            SETSYMBOL(&a, gensym(tokens[i].c_str()));
+        atoms.push_back(a);
+    }
+    return atoms;
+}
+
+typedef void *(*t_stub_fun)(t_int, t_int, t_int, t_int, t_int, t_int, t_floatarg, t_floatarg, t_floatarg, t_floatarg, t_floatarg);
+typedef void *(*t_stub_gimme)(void *, t_symbol *, int, t_atom *);
+
+// Calls a method with Pd's argument marshalling: pointer-sized words and floats in separate registers
+static void *call_typed(t_method fn, const std::vector<t_atomtype> &types, void *self, t_symbol *sel, std::vector<t_atom> atoms)
+{
+    if (!types.empty() && types[0] == A_GIMME)
+    {
+        if (self)
+            return ((t_stub_gimme)fn)(self, sel, (int)atoms.size(), atoms.data());
+        return ((void *(*)(t_symbol *, int, t_atom *))fn)(sel, (int)atoms.size(), atoms.data());
+    }
+
+    t_int ai[6] = {0};
+    t_floatarg af[5] = {0};
+    int ni = 0, nf = 0;
+    if (self)
+        ai[ni++] = (t_int)self;
+    size_t k = 0;
+    for (t_atomtype t : types)
+    {
+        const t_atom *a = k < atoms.size() ? &atoms[k] : nullptr;
+        k++;
+        if (t == A_FLOAT || t == A_DEFFLOAT)
+            af[nf++] = (a && a->a_type == A_FLOAT) ? a->a_w.w_float : 0;
+        else if (t == A_SYMBOL || t == A_DEFSYM)
+            ai[ni++] = (t_int)((a && a->a_type == A_SYMBOL) ? a->a_w.w_symbol : &s_);
+    }
+    return ((t_stub_fun)fn)(ai[0], ai[1], ai[2], ai[3], ai[4], ai[5], af[0], af[1], af[2], af[3], af[4]);
+}
+
+t_object *stub_new(const std::string &line)
+{
+    auto tokens = tokenize(line);
+    auto it = classes().find(tokens.at(0));
+    if (it == classes().end())
+        return nullptr;
+    t_class *c = it->second;
+    constructing = nullptr;
+    void *x = call_typed((t_method)c->newmethod, c->newargs, nullptr, gensym(tokens[0].c_str()), to_atoms(tokens, 1));
+    return (t_object *)x;
+}
+
+void stub_free(t_object *x)
+{
+    t_class *c = x->ob_pd;
+    if (c->freemethod)
+        ((void (*)(void *))c->freemethod)(x);
+    pd_free(&x->ob_pd);
+}
+
+static void dispatch(t_pd *dest, t_symbol *sel, const std::vector<t_atom> &atoms)
+{
+    t_class *c = *dest;
+    for (auto &m : c->methods)
+        if (m.sel == sel)
+        {
+            call_typed(m.fn, m.args, dest, sel, atoms);
+            return;
+        }
+
+    if (sel == &s_float && c->floatmethod)
+        call_typed(c->floatmethod, {A_FLOAT}, dest, sel, atoms);
+    else if (sel == &s_float && c->signalinOffset >= 0)
+        *(t_float *)((char *)dest + c->signalinOffset) = atoms.at(0).a_w.w_float;
+    else if (sel == &s_bang && c->bangmethod)
+        call_typed(c->bangmethod, {}, dest, sel, atoms);
+    else if (sel == &s_list && c->listmethod)
+        call_typed(c->listmethod, {A_GIMME}, dest, sel, atoms);
+    else if (c->anymethod)
+        call_typed(c->anymethod, {A_GIMME}, dest, sel, atoms);
+    else
+        pd_error(dest, "%s: no method for '%s'", c->name->s_name, sel->s_name);
+}
+
+void stub_send(t_object *x, const std::string &msg, int inlet)
+{
+    auto tokens = tokenize(msg);
+    t_float f;
+    t_symbol *sel;
+    std::vector<t_atom> atoms;
+    if (is_number(tokens.at(0), f))
+    {
+        sel = tokens.size() == 1 ? &s_float : &s_list;
+        atoms = to_atoms(tokens, 0);
+    }
+    else
+    {
+        sel = gensym(tokens[0].c_str());
+        atoms = to_atoms(tokens, 1);
+    }
+
+    if (inlet == 0)
+    {
+        dispatch(&x->ob_pd, sel, atoms);
+        return;
+    }
+
+    _inlet *in = stub_of(x).inlets.at(inlet - 1).get();
+    if (in->floatptr)
+        *in->floatptr = atoms.at(0).a_w.w_float;
+    else if (in->signal)
+        in->scalar = atoms.at(0).a_w.w_float;
+    else if (sel == in->from)
+        dispatch(in->dest, in->to, atoms);
+    else
+        dispatch(in->dest, sel, atoms);
+}
+
+void stub_connect(t_object *x, int inlet, int nchans)
+{
+    stub_of(x).connected[inlet] = nchans;
+}
+
+void stub_dsp(t_object *x, t_float sr, int n, int inplace)
+{
+    t_stub_object &o = stub_of(x);
+    o.inplace = inplace;
+    t_class *c = x->ob_pd;
+    o.chain.clear();
+    o.sigs.clear();
+    o.inletSignals.clear();
+    o.n = n;
+    o.sr = sr;
+    currentSr = sr;
+    currentN = n;
+
+    if (c->signalinOffset >= 0)
+        o.inletSignals.push_back(0);
+    for (size_t i = 0; i < o.inlets.size(); i++)
+        if (o.inlets[i]->signal)
+            o.inletSignals.push_back((int)i + 1);
+
+    for (int inlet : o.inletSignals)
+    {
+        auto con = o.connected.find(inlet);
+        t_signal *sig = stub_signal(o, n, con != o.connected.end() ? con->second : 1, sr);
+        sig->s_isscalar = con == o.connected.end();
+        o.sigs.push_back(sig);
+    }
+    for (auto &out : o.outlets)
+        if (out->type == &s_signal)
+        {
+            if (c->flags & CLASS_MULTICHANNEL)
+                o.sigs.push_back(nullptr);
+            else if (o.sigs.size() == o.inletSignals.size() && reusable_input(o, 1))
+                o.sigs.push_back(reusable_input(o, 1));
+            else
+                o.sigs.push_back(stub_signal(o, n, 1, sr));
+        }
+
+    for (auto &m : c->methods)
+        if (m.sel == gensym("dsp"))
+        {
+            building = &o;
+            ((void (*)(void *, t_signal **))m.fn)(x, o.sigs.data());
+            building = nullptr;
+        }
+}
+
+t_sample *stub_inlet(t_object *x, int inlet)
+{
+    t_stub_object &o = stub_of(x);
+    for (size_t i = 0; i < o.inletSignals.size(); i++)
+        if (o.inletSignals[i] == inlet)
+            return o.sigs[i]->s_vec;
+    return nullptr;
+}
+
+t_signal *stub_outlet(t_object *x, int outlet)
+{
+    t_stub_object &o = stub_of(x);
+    return o.sigs.at(o.inletSignals.size() + outlet);
+}
+
+void stub_tick(t_object *x, bool dsp)
+{
+    t_stub_object &o = stub_of(x);
+    t_class *c = x->ob_pd;
+    double next = logicalTime + 1000.0 * o.n / o.sr;
+
+    // fire due clocks in time order, as the Pd scheduler does before each DSP tick
+    for (;;)
+    {
+        t_clock *due = nullptr;
+        for (t_clock *k : clocks)
+            if (k->set && k->settime < next && (!due || k->settime < due->settime))
+                due = k;
+        if (!due)
+            break;
+        logicalTime = due->settime;
+        due->set = false;
+        ((void (*)(void *))due->fn)(due->owner);
+    }
+    logicalTime = next;
+    if (!dsp)
+        return;
+
+    // unconnected signal inlets carry their scalar
+    for (size_t i = 0; i < o.inletSignals.size(); i++)
+    {
+        t_signal *sig = o.sigs[i];
+        if (!sig->s_isscalar)
+            continue;
+        int inlet = o.inletSignals[i];
+        t_float f = inlet == 0 ? *(t_float *)((char *)x + c->signalinOffset) : o.inlets[inlet - 1]->scalar;
+        std::fill(sig->s_vec, sig->s_vec + sig->s_n * sig->s_nchans, f);
+    }
+
+    for (auto &w : o.chain)
+        ((t_perfroutine)w[0])(w.data());
+}
+
+std::vector<std::pair<double, std::string>> stub_timed_messages(t_object *x, int outlet)
+{
+    t_stub_object &o = stub_of(x);
+    int k = 0;
+    std::vector<std::pair<double, std::string>> log;
+    for (auto &out : o.outlets)
+        if (out->type != &s_signal && k++ == outlet)
+        {
+            for (size_t i = 0; i < out->log.size(); i++)
+                log.emplace_back(out->times[i], out->log[i]);
+            out->log.clear();
+            out->times.clear();
+            break;
+        }
+    return log;
+}
+
+std::vector<std::string> stub_messages(t_object *x, int outlet)
+{
+    std::vector<std::string> log;
+    for (auto &m : stub_timed_messages(x, outlet))
+        log.push_back(m.second);
+    return log;
+}
+
+double stub_time()
+{
+    return logicalTime;
+}
@@ -0,0 +1,42 @@
+// pd_stub.h — minimal stand-in for the Pure Data runtime, used to drive externals from test and bench programs
+#pragma once
+
+#include "m_pd.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Creates an object from a creation line such as "adsr~ -voices 4"
+t_object *stub_new(const std::string &line);
+
+// Frees an object created by stub_new
+void stub_free(t_object *x);
+
+// Sends a message such as "attack 10", "start" or "0.5" to the given inlet
+void stub_send(t_object *x, const std::string &msg, int inlet = 0);
+
+// Marks a signal inlet as connected with the given channel count (call before stub_dsp)
+void stub_connect(t_object *x, int inlet, int nchans = 1);
+
+// Builds the DSP chain of the object. With inplace set to a connected signal inlet, the first
+// signal outlet gets that inlet's buffer when it has as many channels, as Pd may arrange.
+void stub_dsp(t_object *x, t_float sr, int n, int inplace = -1);
+
+// Signal vector of a connected inlet (all channels, back to back)
+t_sample *stub_inlet(t_object *x, int inlet);
+
+// Signal of an outlet after stub_dsp
+t_signal *stub_outlet(t_object *x, int outlet);
+
+// Runs due clocks, advances logical time by one block and runs the DSP chain unless dsp is
+// false, as with DSP off or in a switched off subpatch
+void stub_tick(t_object *x, bool dsp = true);
+
+// Messages sent to a control outlet since the last call, one line per message
+std::vector<std::string> stub_messages(t_object *x, int outlet);
+
+// Like stub_messages, with the logical time in milliseconds each message was sent at
+std::vector<std::pair<double, std::string>> stub_timed_messages(t_object *x, int outlet);
+
+// Current logical time in milliseconds
+double stub_time();